@@ -9,16 +9,29 @@
                 "src/napi/core.cc",
                 "src/napi/props.cc",
                 "src/napi/win32.cc",
+                "src/bounded-text.cc",
+                "src/command-ring.cc",
                 "src/data.cc",
+                "src/icon-bitmap.cc",
                 "src/icon-object.cc",
+                "src/icon-surface.cc",
+                "src/icon-variant.cc",
+                "src/icon-watcher.cc",
                 "src/menu-object.cc",
                 "src/notify-icon.cc",
                 "src/notify-icon-message-loop.cc",
                 "src/notify-icon-object.cc",
                 "src/reg-icon-stream.cc",
+                "src/stock-icons.cc",
+                "src/strand.cc",
+                "src/svg-raster.cc",
+                "src/tooltip-updater.cc",
                 "src/parse_guid.cc",
                 "src/module.cc"
             ],
+            "libraries": [
+                "windowscodecs.lib"
+            ],
             "defines": [
                 "_WIN32_WINNT=_WIN32_WINNT_WIN7",
                 "_UNICODE",
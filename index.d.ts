@@ -1,6 +1,15 @@
 export interface Icon {
     readonly width: number;
     readonly height: number;
+    /** Set if the icon was created by `Icon.createSurface()`. */
+    readonly surfaceId?: number;
+
+    /**
+     * Derive an icon with adjusted pixels, e.g. for disabled or offline states.
+     * Results are cached per options for as long as this icon is alive, except for
+     * surface icons, where the result is a snapshot of the current pixels.
+     */
+    variant(options: Readonly<Icon.VariantOptions>): Icon;
 }
 
 export namespace Icon {
@@ -21,6 +30,15 @@ export namespace Icon {
         readonly shield: BuiltinId;// = 32518;
     };
 
+    export interface VariantOptions {
+        /** Convert to grayscale by luminance. */
+        grayscale?: boolean;
+        /** Color as `0xRRGGBB` to multiply each pixel by, after `grayscale`. */
+        tint?: number;
+        /** Multiplier for alpha, from `0` to `1`. */
+        opacity?: number;
+    }
+
     export const small: Readonly<Size>;
     export const large: Readonly<Size>;
 
@@ -30,6 +48,137 @@ export namespace Icon {
     /** Native API to load a built-in icon at a specific size. */
     export function loadBuiltin(id: BuiltinId, size: Readonly<Size>): Icon;
     export function loadFile(path: string, size: Readonly<Size>): Icon;
+    /**
+     * Load an icon from a `.ico` file or any image format supported by the Windows
+     * Imaging Component, e.g. PNG, in memory. Images are scaled to `size` if needed.
+     */
+    export function loadBuffer(buffer: Buffer, size: Readonly<Size>): Icon;
+    /**
+     * Load an icon from an entry of a zip or Electron asar archive without extracting it,
+     * as with `loadBuffer()`. The archive index is read once and cached while the archive
+     * is unchanged; only the entry itself is read on each call. Zip entries must be
+     * stored or deflated; asar entries marked as unpacked are read from `.asar.unpacked`.
+     * @param archivePath Path of the archive, e.g. `path.join(process.resourcesPath, "app.asar")`.
+     * @param entryPath Path within the archive, e.g. `"icons/tray.ico"`.
+     */
+    export function loadFromArchive(archivePath: string, entryPath: string, size: Readonly<Size>): Icon;
+    /**
+     * Load an icon file like `loadFile()`, then reload it whenever it changes, updating
+     * any `NotifyIcon` showing it. Changes are detected and decoded on a background
+     * thread, after they have settled for 100ms. If a reload fails, e.g. the file is
+     * invalid, the previous image is kept.
+     */
+    export function watch(path: string, size: Readonly<Size>): Icon;
+    /**
+     * Load the Windows stock icon closest to a freedesktop.org icon naming spec name,
+     * e.g. `"network-offline"` or `"dialog-warning"`, so the same names can be used
+     * across platforms. Like the spec, unknown names fall back by removing
+     * dash-separated suffixes, e.g. `"folder-documents-symbolic"` loads `"folder"`.
+     * Throws if nothing matches.
+     */
+    export function loadNamed(name: string, size: Readonly<Size>): Icon;
+
+    export interface AtlasOptions {
+        /** Width of each tile in pixels, which is also the width of the created icons. */
+        tileWidth: number;
+        /** Height of each tile in pixels, which is also the height of the created icons. */
+        tileHeight: number;
+        /**
+         * Number of tiles to create icons for, counting left to right then top to bottom.
+         * Default is every complete tile in the image.
+         */
+        count?: number;
+    }
+
+    /**
+     * Load a set of icons from tiles of a single image, e.g. a PNG strip of icon states.
+     * The image is decoded once, and the icons share the decoded pixels until they are
+     * first used.
+     * @param pathOrBuffer Path of, or a `Buffer` containing, an image in any format
+     *      supported by the Windows Imaging Component, e.g. PNG.
+     * @param options Size and number of the tiles.
+     */
+    export function loadAtlas(pathOrBuffer: string | Buffer, options: Readonly<AtlasOptions>): Icon[];
+
+    /**
+     * Render an SVG document to an icon of the given size.
+     * Supports the subset of SVG commonly used for icons: paths and basic shapes,
+     * solid, linear and radial gradient fills and strokes, and transforms.
+     * Renders are cached by document content and size, so calling this again,
+     * e.g. when the DPI changes, is cheap.
+     * @param source SVG document text, or a `Buffer` containing it encoded as UTF-8.
+     * @param size Size to render the document's `viewBox` to, centered, at most
+     *     1024 in each dimension.
+     * @throws If the document is invalid, or nests elements more than 256 deep.
+     */
+    export function fromSVG(source: string | Buffer, size: Readonly<Size>): Icon;
+
+    /**
+     * Maximum number of native icon handles to keep, or `0` (the default) for no limit.
+     * Beyond it, the least recently used icons that aren't currently used by a
+     * `NotifyIcon` release their handle, keeping only their pixels, and recreate it
+     * when they are next used. Built-in icons are shared and are not counted.
+     */
+    export let handleBudget: number;
+
+    export interface HandleStats {
+        /** Number of icons currently holding a native handle. */
+        readonly resident: number;
+        /** Total number of times an icon has released its handle. */
+        readonly evicted: number;
+        /** Total number of times an evicted icon has recreated its handle. */
+        readonly rematerialized: number;
+    }
+
+    export const handleStats: HandleStats;
+
+    /** Plain data identifying a surface, which can be sent to a worker with `postMessage()`. */
+    export interface SurfaceHandle {
+        readonly id: number;
+        readonly width: number;
+        readonly height: number;
+        readonly buffer: SharedArrayBuffer;
+    }
+
+    export interface Surface {
+        readonly handle: SurfaceHandle;
+        /** Icon showing the surface, or `null` if it was opened with `Icon.openSurface()`. */
+        readonly icon: Icon | null;
+        readonly width: number;
+        readonly height: number;
+        /**
+         * Pixels as `0xAARRGGBB` with straight (not premultiplied) alpha, in rows of `width`,
+         * top to bottom.
+         */
+        readonly pixels: Uint32Array;
+        /**
+         * Publish the pixels to every `NotifyIcon` showing the surface icon. Can be called from
+         * any thread; the pixels are copied directly, and the icons are updated from the
+         * notification area message thread.
+         * @param rect Area that has changed since the last commit, default is everything.
+         */
+        commit(rect?: Readonly<Rect>): void;
+    }
+
+    export interface Rect {
+        x: number;
+        y: number;
+        width: number;
+        height: number;
+    }
+
+    /**
+     * Create pixels in a `SharedArrayBuffer` for live updates of an icon, e.g. from a
+     * `worker_threads` Worker, without passing them through the main thread.
+     * Starts fully transparent.
+     */
+    export function createSurface(width: number, height: number): Surface;
+    /** Open a surface from its handle in another thread, to draw and commit it there. */
+    export function openSurface(handle: SurfaceHandle): Surface;
+    /** Native API used by `Surface`. */
+    export function createSurfaceIcon(size: Readonly<Size>): Icon;
+    /** Native API used by `Surface#commit()`. */
+    export function commitSurface(id: number, pixels: Uint32Array, rect?: Readonly<Rect>): void;
 }
 
 export namespace Menu {
@@ -143,12 +292,12 @@ interface NotificationOptions {
      */
     icon?: Icon;
     /**
-     * Title of the notification.
+     * Title of the notification, truncated with "…" to 63 characters.
      * At least one of `title` and `text` is required (present and non-empty).
      */
     title?: string;
     /**
-     * Body text of the notification.
+     * Body text of the notification, truncated with "…" to 255 characters.
      * At least one of `title` and `text` is required (present and non-empty).
      */
     text?: string;
@@ -169,9 +318,143 @@ interface NotificationOptions {
      * Default is `true`.
      */
     sound?: boolean;
+    /**
+     * Order to show queued notifications in, highest first, see
+     * `notificationMinIntervalMs`. Default is `0`.
+     */
+    priority?: number;
 }
 
 export namespace NotifyIcon {
+    export interface BatchStats {
+        /** Total number of `update()` calls. */
+        readonly updates: number;
+        /** Total number of shell calls made by `update()`, immediately or in a batch. */
+        readonly shellCalls: number;
+        /** `updates - shellCalls`, the calls saved by batching. */
+        readonly saved: number;
+    }
+
+    export interface DispatchStats {
+        /** Waiting to run. */
+        readonly depth: number;
+        /** Most that have been waiting at once. */
+        readonly highWater: number;
+        /** Dropped as `dispatchQueueLimit` were waiting. */
+        readonly dropped: number;
+        /** Times the thread was woken to run those waiting. */
+        readonly batches: number;
+    }
+
+    export interface ModifyStats {
+        readonly sent: number;
+        readonly skipped: number;
+    }
+
+    export interface NotificationStats {
+        /** Waiting to be shown. */
+        readonly queued: number;
+        readonly sent: number;
+        /** Identical to one already queued. */
+        readonly merged: number;
+        /** Lowest priority when the queue was full. */
+        readonly dropped: number;
+    }
+
+    export type StateOptions = Pick<Options, "icon" | "tooltip" | "hidden">;
+
+    export interface CommandRingOptions {
+        /** Names of states from `defineStates()` that commands can set. */
+        states?: readonly string[];
+        /** Tooltips that commands can set. */
+        tooltips?: readonly string[];
+        /** Commands that can be waiting to be applied, a power of two. Default is `256`. */
+        capacity?: number;
+    }
+
+    /** Plain data identifying a ring, which can be sent to a worker with `postMessage()`. */
+    export interface CommandRingHandle {
+        readonly id: number;
+        readonly capacity: number;
+        readonly buffer: SharedArrayBuffer;
+        readonly states: readonly string[];
+        readonly tooltips: readonly string[];
+    }
+
+    /** Each field is left as is if not given. */
+    export interface CommandRingCommand {
+        /** Name or index of one of the ring's states. */
+        state?: string | number;
+        /** One of the ring's tooltips, or its index. */
+        tooltip?: string | number;
+        hidden?: boolean;
+    }
+
+    export interface CommandRing {
+        readonly handle: CommandRingHandle;
+        /**
+         * Post a command without blocking. Commands waiting when the message thread
+         * gets to them are merged, so only the latest of each field is sent.
+         * @returns `false` if the ring was full and the command was dropped.
+         */
+        post(command: Readonly<CommandRingCommand>): boolean;
+        /** `null` once the ring has been replaced or its icon removed. */
+        readonly stats: CommandRingStats | null;
+    }
+
+    export interface CommandRingStats {
+        /** Commands written to the ring. */
+        readonly posted: number;
+        /** Commands not written, as the ring was full. */
+        readonly dropped: number;
+        /** Commands read by the message thread. */
+        readonly applied: number;
+        /** Times a writer woke the message thread. */
+        readonly wakes: number;
+        /** Times the message thread read the ring. */
+        readonly drains: number;
+        /** Time from the first wake to the ring being read, in microseconds. */
+        readonly meanLatencyUs: number;
+        readonly maxLatencyUs: number;
+    }
+
+    export interface TooltipUpdaterOptions {
+        /**
+         * Tooltip text, with `{index}` or `{index:.precision}` replaced by the value
+         * of that source, e.g. `"Queue: {0}, CPU: {1:.1}%"`. Use `{{` for a literal
+         * `{`. Truncated to 127 characters once formatted.
+         */
+        template: string;
+        sources: readonly TooltipUpdaterSource[];
+        /** How often to check the sources. Default is `1000`, minimum is `10`. */
+        intervalMs?: number;
+    }
+
+    export type TooltipUpdaterSource =
+        | {
+              /** An array over a `SharedArrayBuffer`, kept alive by the updater. */
+              array: Int32Array | Uint32Array | Float32Array | Float64Array;
+              /** Index of the element to read. */
+              index: number;
+          }
+        | {
+              /** File to map, e.g. written by another process. */
+              file: string;
+              byteOffset: number;
+              /** Default is `"int32"`. */
+              type?: "int32" | "uint32" | "float32" | "float64";
+          };
+
+    export interface TooltipStats {
+        readonly sent: number;
+        /** Replaced by a later tooltip before they could be sent. */
+        readonly dropped: number;
+        /** Calls to `onTooltipRequest`. */
+        readonly requested: number;
+        /** Sent by the tooltip updater. */
+        readonly updated: number;
+    }
+
     /**
      * Properties for the clickable icon in the notification area (aka. system tray).
      */
@@ -182,8 +465,32 @@ export namespace NotifyIcon {
          * Should be created with the size `Icon.small`.
          */
         icon?: Icon;
-        /** Tooltip displayed when hovered or keyboard navigated. */
+        /**
+         * Tooltip displayed when hovered or keyboard navigated, truncated with "…"
+         * to 127 characters.
+         */
         tooltip?: string;
+        /**
+         * Minimum time between tooltip updates sent to the shell, for tooltips
+         * showing frequently changing values. Updates sooner than this are held
+         * back, and only the latest is sent once the interval is up.
+         * Applies to later updates. Default is `0`, no limit.
+         */
+        tooltipMinIntervalMs?: number;
+        /**
+         * Minimum time each notification is shown before the next replaces it.
+         * Later notifications wait in a queue by `priority`, and identical ones
+         * (same title and text) are shown once, with a count added to the title.
+         * Ones identical to the notification being shown are dropped.
+         * Removing the notification (`notification: null`) also clears the queue.
+         * Applies to later updates. Default is `0`, show each immediately.
+         */
+        notificationMinIntervalMs?: number;
+        /**
+         * Most notifications to queue, after which the lowest priority are dropped.
+         * `0` disables the queue, showing each immediately. Default is `16`.
+         */
+        notificationQueueLimit?: number;
         /**
          * Hide the icon completely.
          * Note that you cannot show notifications while hidden.
@@ -202,6 +509,60 @@ export namespace NotifyIcon {
          * for some menu.
          */
         onSelect?: (this: NotifyIcon, event: SelectEvent) => void;
+
+        /**
+         * Callback fired with the other shell events for this icon listed in `events`,
+         * in the order they happened. Events are batched: those waiting when the JS
+         * thread gets to them are passed in one call, with mouse moves merged so only
+         * the latest position is given.
+         */
+        onEvents?: (this: NotifyIcon, events: ShellEvent[]) => void;
+
+        /**
+         * Instead of `onEvents`, called when events are waiting, to be taken with
+         * `takeEvents()`. Used by `events()`.
+         */
+        onEventsAvailable?: ((this: NotifyIcon) => void) | null;
+
+        /**
+         * Events to pass to `onEvents`. Other events don't wake the JS thread at all.
+         * Default is every type.
+         */
+        events?: readonly ShellEventType[];
+
+        /**
+         * Most events that can be waiting for the JS thread, after which
+         * `eventOverflow` decides which are lost. Default is `256`.
+         */
+        eventBufferSize?: number;
+
+        /**
+         * Which events are lost once `eventBufferSize` are waiting:
+         * - `"dropOldest"` (default): the oldest waiting event.
+         * - `"dropNewest"`: the new event.
+         * - `"coalesce"`: the latest waiting event of the same type is replaced by the
+         *   new one, or if there is none, the oldest waiting event is dropped.
+         *
+         * Mouse moves always replace any waiting mouse move.
+         */
+        eventOverflow?: EventOverflow;
+
+        /**
+         * Callback fired when the user hovers over the icon, returning the tooltip
+         * to show, or `undefined` to keep the current one. Lets tooltips showing
+         * frequently changing values be computed only when they could be seen,
+         * rather than updated continuously. Pass `null` to remove.
+         *
+         * Set an initial `tooltip` as well, as the standard tooltip is only shown
+         * once one has been set. While `*Async()` calls on the icon are pending,
+         * the result is sent once they complete.
+         */
+        onTooltipRequest?: ((this: NotifyIcon) => string | undefined) | null;
+        /**
+         * How long the result of `onTooltipRequest` is used for before it is
+         * called again. Default is `1000`.
+         */
+        tooltipTtlMs?: number;
     }
 
     /**
@@ -214,6 +575,59 @@ export namespace NotifyIcon {
         mouseY: number;
     }
 
+    export type ShellEventType =
+        | "mouseMove"
+        | "balloonShow"
+        | "balloonHide"
+        | "balloonTimeout"
+        | "balloonClick"
+        | "popupOpen"
+        | "popupClose"
+        | "select";
+
+    export type EventOverflow = "dropOldest" | "dropNewest" | "coalesce";
+
+    export interface ShellEvent {
+        type: ShellEventType;
+        /** Screen position of the mouse, or the icon if the keyboard was used. */
+        mouseX: number;
+        mouseY: number;
+        /** Set for `"select"` events. */
+        rightButton?: boolean;
+    }
+
+    export interface EventsOptions {
+        /** Event types to include, default is every type. */
+        types?: readonly ShellEventType[];
+        /** Most events waiting to be consumed, see `eventBufferSize`. Default is `64`. */
+        highWaterMark?: number;
+        /** See `eventOverflow`. Default is `"dropOldest"`. */
+        overflow?: EventOverflow;
+    }
+
+    export interface EventIterator extends AsyncIterableIterator<ShellEvent> {
+        /** Events this icon has lost to the overflow policy. */
+        readonly dropped: number;
+    }
+
+    export interface EventBufferStats {
+        /** Waiting to be delivered or taken. */
+        readonly queued: number;
+        /** Lost to the overflow policy. */
+        readonly dropped: number;
+    }
+
+    export interface EventStats {
+        /** Events passed to `onEvents` callbacks or returned by `takeEvents()`. */
+        readonly delivered: number;
+        /** Replaced by a later event before they were delivered. */
+        readonly merged: number;
+        /** Lost to an icon's overflow policy. */
+        readonly dropped: number;
+        /** Times the JS thread was woken to deliver events. */
+        readonly batches: number;
+    }
+
     /**
      * Initial properties for the clickable icon in the notification area (system tray).
      */
@@ -258,21 +672,189 @@ export class NotifyIcon {
      * @param options
      *      Options controlling the creation, display of the icon, and optionally
      *      the notification ("toast" or "balloon").
+     *
+     * If the taskbar is restarted, e.g. when explorer.exe crashes, the icon is
+     * added again as last shown (without any notification).
      */
     constructor(options?: NotifyIcon.NewOptions);
 
+    /**
+     * Like `new NotifyIcon(options)`, but the shell is called on a background
+     * thread, so a busy shell doesn't block the JS thread. Resolves with the icon
+     * once it has been added. Calls for each icon are made in order, while
+     * different icons don't wait on each other.
+     *
+     * @param options
+     *      As for the constructor.
+     */
+    static createAsync(options?: NotifyIcon.NewOptions): Promise<NotifyIcon>;
+
+    /**
+     * Create several icons at once, with their shell calls made together rather
+     * than a round trip per icon. If any fail to be added, the others are removed
+     * and the error is thrown.
+     *
+     * @param options
+     *      As for the constructor, for each icon.
+     */
+    static createMany(options: readonly NotifyIcon.NewOptions[]): NotifyIcon[];
+
+    /**
+     * Remove several icons at once, with their shell calls made together. Errors
+     * are thrown after trying all of them.
+     *
+     * @param icons
+     *      Icons to remove. Default is every icon.
+     */
+    static removeAll(icons?: readonly NotifyIcon[]): void;
+
     /**
      * Update the options for a notification icon, and optionally a notification.
      * Only the provided options (exists and not `undefined`) will be updated.
      *
+     * Throws if `*Async()` calls on this icon haven't settled yet, as they could
+     * otherwise overwrite this update.
+     *
      * @param options 
      *      Options to be updated controlling the display of the icon, and optionally
      *      the notification ("toast" or "balloon").
      */
     update(options?: NotifyIcon.Options): void;
 
+    /**
+     * Like `update()`, but the shell is called on a background thread, in order
+     * with the other `*Async()` calls for this icon. Not merged into batches,
+     * and throws if this icon has updates in an open batch, as they would
+     * otherwise overwrite this one.
+     *
+     * @param options
+     *      As for `update()`.
+     */
+    updateAsync(options?: NotifyIcon.Options): Promise<void>;
+
+    /**
+     * Define named states the icon can be switched between with `setState()`,
+     * e.g. idle, syncing and error. Each is checked and prepared for the shell
+     * up front, so switching is cheaper than `update()`. Adds to or replaces
+     * earlier definitions with the same names. States can't include
+     * notifications or surface icons (from `Icon.createSurface()`), and their
+     * icons are kept loaded while defined.
+     *
+     * @param states
+     *      Options for each state.
+     */
+    defineStates(states: Record<string, NotifyIcon.StateOptions>): void;
+
+    /**
+     * Switch to a state defined with `defineStates()`. Throws if `*Async()` calls
+     * on this icon haven't settled yet, as for `update()`. If this icon has
+     * updates in an open batch, the state is merged into them and sent with the
+     * batch.
+     *
+     * @param name
+     *      Name of the state.
+     */
+    setState(name: string): void;
+
+    /**
+     * Keep the tooltip up to date with counters that other threads or processes
+     * publish in shared memory, without running any JS. The sources are polled on
+     * a timer, and the tooltip is only sent when a value changes. Replaces any
+     * previous updater, or removes it if `null`.
+     *
+     * @param options
+     *      Template, sources and interval for the updater.
+     */
+    setTooltipUpdater(options: NotifyIcon.TooltipUpdaterOptions | null): void;
+
+    /**
+     * Create a ring buffer in a `SharedArrayBuffer` for posting updates to this icon from
+     * any thread, e.g. a `worker_threads` Worker. The updates are applied by the
+     * notification area message thread, without passing through the thread that owns
+     * the icon. Replaces any previous ring for this icon, which then stops being read.
+     */
+    createCommandRing(options?: NotifyIcon.CommandRingOptions): NotifyIcon.CommandRing;
+    /**
+     * Native API used by `createCommandRing()`. Returns the ring id, or removes the ring
+     * if `slots` is `null`. `slots` must be over a `SharedArrayBuffer`.
+     */
+    setCommandRing(
+        slots: Int32Array | null,
+        states?: readonly string[],
+        tooltips?: readonly string[],
+    ): number | undefined;
+    /** Open a ring from its handle in another thread, to post to it there. */
+    static openCommandRing(handle: NotifyIcon.CommandRingHandle): NotifyIcon.CommandRing;
+    /** Native API used by `CommandRing#post()`. */
+    static wakeCommandRing(id: number): boolean;
+    /** Native API used by `CommandRing#stats`. */
+    static commandRingStats(id: number): Omit<NotifyIcon.CommandRingStats, "posted" | "dropped"> | undefined;
+
     /**
      * Remove this notification icon and any notification it is showing.
      */
     remove(): void;
+
+    /**
+     * Like `remove()`, but the shell is called on a background thread, in order
+     * with the other `*Async()` calls for this icon. Throws if this icon has
+     * updates in an open batch, as for `updateAsync()`.
+     */
+    removeAsync(): Promise<void>;
+
+    /** Counts of tooltip updates for this icon, see `tooltipMinIntervalMs`. */
+    readonly tooltipStats: NotifyIcon.TooltipStats;
+
+    /** Counts of notifications for this icon, see `notificationMinIntervalMs`. */
+    readonly notificationStats: NotifyIcon.NotificationStats;
+
+    /**
+     * Iterate over this icon's events with `for await`, ending when the icon is removed
+     * or the loop exits. Events are taken from a bounded buffer only as they are
+     * consumed, so a slow consumer loses events by `overflow` rather than slowing the
+     * notification area. Uses `onEventsAvailable` and `events`, so only one iterator
+     * per icon should be used at a time.
+     */
+    events(options?: NotifyIcon.EventsOptions): NotifyIcon.EventIterator;
+    /** Native API used by `events()`: removes and returns up to `max` waiting events. */
+    takeEvents(max?: number): NotifyIcon.ShellEvent[];
+    /** Events buffered for this icon, see `eventBufferSize`. */
+    readonly eventBufferStats: NotifyIcon.EventBufferStats;
+
+    /**
+     * Call `fn`, merging all `update()` calls made during it for each icon, then send
+     * one update per icon when it returns. Can be nested; updates are sent when the
+     * outermost batch ends. Errors from sending are thrown after all icons are updated.
+     * @returns The result of `fn`.
+     */
+    static batch<T>(fn: () => T): T;
+    /** Native API used by `batch()`. */
+    static beginBatch(): void;
+    /** Native API used by `batch()`. */
+    static endBatch(): void;
+    /**
+     * If `true`, `update()` calls are batched automatically until the end of the current
+     * tick (as a microtask), as if wrapped in `batch()`. Errors sending the updates are
+     * thrown from the microtask. Default `false`.
+     */
+    static autoBatch: boolean;
+    /** Counts of `update()` calls, and the shell calls made for them. */
+    static readonly batchStats: NotifyIcon.BatchStats;
+    /**
+     * Counts of updates sent to the shell, and those skipped because nothing had
+     * changed, across all icons in the process. Only options that differ from what was
+     * last sent are sent; notifications are always sent.
+     */
+    static readonly modifyStats: NotifyIcon.ModifyStats;
+    /** Counts of events delivered to `onEvents` callbacks in this thread. */
+    static readonly eventStats: NotifyIcon.EventStats;
+    /**
+     * Most calls from the notification area to this thread that can be waiting, e.g.
+     * `onSelect` and `onTooltipRequest`, before new ones are dropped so the
+     * notification area never waits on a busy thread. Completions such as the promises
+     * from `Menu#show()` and the `*Async()` methods are never dropped. Default `1024`.
+     */
+    static dispatchQueueLimit: number;
+    /** Calls from the notification area to this thread, see `dispatchQueueLimit`. */
+    static readonly dispatchStats: NotifyIcon.DispatchStats;
 }
@@ -1,9 +1,57 @@
 const native = require('./notify_icon.node');
+const path = require('path');
+const zlib = require('zlib');
+// Electron's patched fs treats .asar archives as directories.
+const fs = process.versions.electron ? require('original-fs') : require('fs');
 
 const { NotifyIcon, Icon, Menu } = native;
 
 module.exports = { NotifyIcon, Icon, Menu };
 
+Object.defineProperties(NotifyIcon, {
+    batch: {
+        enumerable: true,
+        value: function NotifyIcon_batch(fn) {
+            NotifyIcon.beginBatch();
+            try {
+                return fn();
+            } finally {
+                NotifyIcon.endBatch();
+            }
+        },
+    },
+});
+
+Object.defineProperties(NotifyIcon, {
+    openCommandRing: {
+        enumerable: true,
+        value: function NotifyIcon_openCommandRing(handle) {
+            return new CommandRing(handle);
+        },
+    },
+});
+
+Object.defineProperties(NotifyIcon.prototype, {
+    events: {
+        value: function NotifyIcon_events(options = {}) {
+            const { types, highWaterMark = 64, overflow = "dropOldest" } = options;
+            return new NotifyIconEvents(this, types, highWaterMark, overflow);
+        },
+    },
+    createCommandRing: {
+        value: function NotifyIcon_createCommandRing(options = {}) {
+            const { states = [], tooltips = [], capacity = 256 } = options;
+            if (!(capacity > 0) || (capacity & (capacity - 1)) !== 0) {
+                throw new RangeError("'capacity' must be a power of two.");
+            }
+            // Header fields, see command-ring.hh, then the slots.
+            const buffer = new SharedArrayBuffer((COMMAND_RING_HEADER + capacity) * 4);
+            const id = this.setCommandRing(new Int32Array(buffer), states, tooltips);
+            return new CommandRing({ id, capacity, buffer, states, tooltips });
+        },
+    },
+});
+
 Object.defineProperties(Menu, {
     createTemplate: { value: createMenuTemplate, enumerable: true },
 });
@@ -34,8 +82,350 @@ Object.defineProperties(Icon, {
             }
         },
     },
+    loadFromArchive: {
+        enumerable: true,
+        value: function Icon_loadFromArchive(archivePath, entryPath, size) {
+            return Icon.loadBuffer(readArchiveEntry(archivePath, entryPath), size);
+        },
+    },
+    createSurface: {
+        enumerable: true,
+        value: function Icon_createSurface(width, height) {
+            const icon = Icon.createSurfaceIcon({ width, height });
+            const buffer = new SharedArrayBuffer(width * height * 4);
+            return new IconSurface({ id: icon.surfaceId, width, height, buffer }, icon);
+        },
+    },
+    openSurface: {
+        enumerable: true,
+        value: function Icon_openSurface(handle) {
+            return new IconSurface(handle, null);
+        },
+    },
 });
 
+// Pixels that can be drawn and committed from any thread, while the icon
+// is only usable from the thread that created it. Pass `handle` to a worker
+// with `postMessage()`, then use `Icon.openSurface()` there.
+class IconSurface {
+    constructor(handle, icon) {
+        this.handle = handle;
+        this.icon = icon;
+        this.width = handle.width;
+        this.height = handle.height;
+        this.pixels = new Uint32Array(handle.buffer);
+    }
+
+    commit(rect) {
+        Icon.commitSurface(this.handle.id, this.pixels, rect);
+    }
+}
+
+// Async iterator over the events of a NotifyIcon, pulling them from the
+// icon's native buffer only as fast as they are consumed, so a slow consumer
+// loses events by the overflow policy rather than piling them up.
+class NotifyIconEvents {
+    constructor(icon, types, highWaterMark, overflow) {
+        this.icon = icon;
+        this.highWaterMark = highWaterMark;
+        this.pending = [];
+        this.wake = null;
+        this.done = false;
+        icon.update({
+            events: types,
+            eventBufferSize: highWaterMark,
+            eventOverflow: overflow,
+            onEventsAvailable: () => {
+                const wake = this.wake;
+                this.wake = null;
+                if (wake) {
+                    wake();
+                }
+            },
+        });
+    }
+
+    [Symbol.asyncIterator]() {
+        return this;
+    }
+
+    async next() {
+        while (!this.done) {
+            if (this.pending.length) {
+                return { value: this.pending.shift(), done: false };
+            }
+            if (!this.icon.id) {
+                break;
+            }
+            this.pending = this.icon.takeEvents(this.highWaterMark);
+            if (!this.pending.length) {
+                await new Promise(resolve => this.wake = resolve);
+            }
+        }
+        return this.return();
+    }
+
+    async return() {
+        if (!this.done) {
+            this.done = true;
+            this.pending = [];
+            if (this.icon.id) {
+                this.icon.update({ onEventsAvailable: null });
+            }
+            const wake = this.wake;
+            this.wake = null;
+            if (wake) {
+                wake();
+            }
+        }
+        return { value: undefined, done: true };
+    }
+
+    /** Events lost to the overflow policy, for this icon. */
+    get dropped() {
+        return this.icon.eventBufferStats.dropped;
+    }
+}
+
+const COMMAND_RING_WRITE = 0;
+const COMMAND_RING_READ = 1;
+const COMMAND_RING_WAKE = 2;
+const COMMAND_RING_DROPPED = 3;
+const COMMAND_RING_HEADER = 4;
+
+// Updates for a NotifyIcon that can be posted from any thread, and are applied
+// by its message thread without going through the thread that owns the icon.
+// Pass `handle` to a worker with `postMessage()`, then use
+// `NotifyIcon.openCommandRing()` there.
+class CommandRing {
+    constructor(handle) {
+        this.handle = handle;
+        this.slots = new Int32Array(handle.buffer);
+        this.capacity = handle.capacity;
+        this.stateIndexes = new Map(handle.states.map((name, index) => [name, index]));
+        this.tooltipIndexes = new Map(handle.tooltips.map((text, index) => [text, index]));
+    }
+
+    post(command) {
+        const word = this.encode(command);
+        if (word === 0) {
+            return true;
+        }
+        const slots = this.slots;
+        for (;;) {
+            const write = Atomics.load(slots, COMMAND_RING_WRITE);
+            const read = Atomics.load(slots, COMMAND_RING_READ);
+            if (((write - read) | 0) >= this.capacity) {
+                Atomics.add(slots, COMMAND_RING_DROPPED, 1);
+                return false;
+            }
+            if (Atomics.compareExchange(slots, COMMAND_RING_WRITE, write, (write + 1) | 0) === write) {
+                Atomics.store(slots, COMMAND_RING_HEADER + (write & (this.capacity - 1)), word);
+                break;
+            }
+        }
+        if (Atomics.exchange(slots, COMMAND_RING_WAKE, 1) === 0) {
+            NotifyIcon.wakeCommandRing(this.handle.id);
+        }
+        return true;
+    }
+
+    encode({ state, tooltip, hidden }) {
+        let word = 0;
+        if (state !== undefined) {
+            const index = typeof state === "number" ? state : this.stateIndexes.get(state);
+            if (index === undefined || !(index >= 0 && index < this.handle.states.length)) {
+                throw new RangeError(`Unknown state "${state}".`);
+            }
+            word |= index + 1;
+        }
+        if (tooltip !== undefined) {
+            const index = typeof tooltip === "number" ? tooltip : this.tooltipIndexes.get(tooltip);
+            if (index === undefined || !(index >= 0 && index < this.handle.tooltips.length)) {
+                throw new RangeError(`Unknown tooltip "${tooltip}".`);
+            }
+            word |= (index + 1) << 12;
+        }
+        if (hidden !== undefined) {
+            word |= (hidden ? 2 : 1) << 24;
+        }
+        return word;
+    }
+
+    get stats() {
+        const stats = NotifyIcon.commandRingStats(this.handle.id);
+        if (!stats) {
+            return null;
+        }
+        return {
+            posted: Atomics.load(this.slots, COMMAND_RING_WRITE) >>> 0,
+            dropped: Atomics.load(this.slots, COMMAND_RING_DROPPED) >>> 0,
+            ...stats,
+        };
+    }
+}
+
+// Archive indexes by absolute path, reused while the archive is unchanged.
+const archiveIndexes = new Map();
+
+function readArchiveEntry(archivePath, entryPath) {
+    archivePath = path.resolve(archivePath);
+    entryPath = entryPath.replace(/\\/g, '/').replace(/^(\.?\/)+/, '');
+
+    const fd = fs.openSync(archivePath, 'r');
+    try {
+        const stat = fs.fstatSync(fd);
+        let index = archiveIndexes.get(archivePath);
+        if (!index || index.mtimeMs !== stat.mtimeMs || index.size !== stat.size) {
+            index = readArchiveIndex(fd, archivePath, stat.size);
+            index.mtimeMs = stat.mtimeMs;
+            index.size = stat.size;
+            archiveIndexes.set(archivePath, index);
+        }
+
+        const entry = index.entries.get(entryPath);
+        if (!entry) {
+            throw new Error(`'${entryPath}' not found in ${archivePath}`);
+        }
+        if (entry.unpacked) {
+            return fs.readFileSync(path.join(`${archivePath}.unpacked`, entryPath));
+        }
+
+        if (entry.offset === undefined) {
+            // struct ZIP_LOCAL_FILE_HEADER {
+            //    0 uint32 signature = 0x04034b50;
+            //   ..
+            //   26 uint16 nameLength;
+            //   28 uint16 extraLength;
+            //   30 char name[nameLength];
+            //   .. byte extra[extraLength];
+            // }
+            const header = readAt(fd, entry.localOffset, 30);
+            if (header.readUInt32LE(0) !== 0x04034b50) {
+                throw new Error(`Invalid zip entry '${entryPath}' in ${archivePath}`);
+            }
+            entry.offset = entry.localOffset + 30 + header.readUInt16LE(26) + header.readUInt16LE(28);
+        }
+
+        const data = readAt(fd, entry.offset, entry.compressedSize);
+        switch (entry.method) {
+            case 0: // stored
+                return data;
+            case 8: // deflated
+                return zlib.inflateRawSync(data);
+            default:
+                throw new Error(`Unsupported zip compression method ${entry.method} for '${entryPath}' in ${archivePath}`);
+        }
+    } finally {
+        fs.closeSync(fd);
+    }
+}
+
+function readAt(fd, position, length) {
+    const buffer = Buffer.alloc(length);
+    if (fs.readSync(fd, buffer, 0, length, position) !== length) {
+        throw new Error("Unexpected end of archive");
+    }
+    return buffer;
+}
+
+function readArchiveIndex(fd, archivePath, fileSize) {
+    const magic = readAt(fd, 0, 4);
+    if (magic.readUInt32LE(0) === 0x04034b50) {
+        return readZipIndex(fd, archivePath, fileSize);
+    }
+    return readAsarIndex(fd);
+}
+
+function readAsarIndex(fd) {
+    // Two Chromium Pickles:
+    //   0 uint32 payloadSize = 4;
+    //   4 uint32 headerSize;
+    //   8 uint32 headerPayloadSize;
+    //  12 uint32 jsonLength;
+    //  16 char json[jsonLength];
+    // File offsets in the JSON are relative to the end of the header.
+    const sizes = readAt(fd, 0, 8);
+    const headerSize = sizes.readUInt32LE(4);
+    const header = readAt(fd, 8, headerSize);
+    const json = JSON.parse(header.toString('utf8', 8, 8 + header.readUInt32LE(4)));
+    const base = 8 + headerSize;
+
+    const entries = new Map();
+    addFiles(json, '');
+    return { entries };
+
+    function addFiles(node, prefix) {
+        for (const [name, child] of Object.entries(node.files)) {
+            if (child.files) {
+                addFiles(child, `${prefix}${name}/`);
+            } else if (child.unpacked) {
+                entries.set(prefix + name, { unpacked: true });
+            } else if (!child.link) {
+                entries.set(prefix + name, {
+                    offset: base + Number(child.offset),
+                    compressedSize: child.size,
+                    method: 0,
+                });
+            }
+        }
+    }
+}
+
+function readZipIndex(fd, archivePath, fileSize) {
+    // struct ZIP_END_OF_CENTRAL_DIRECTORY {
+    //    0 uint32 signature = 0x06054b50;
+    //   ..
+    //   10 uint16 entryCount;
+    //   12 uint32 directorySize;
+    //   16 uint32 directoryOffset;
+    //   20 uint16 commentLength;
+    //   22 char comment[commentLength];
+    // }
+    const tailSize = Math.min(fileSize, 22 + 0xffff);
+    const tail = readAt(fd, fileSize - tailSize, tailSize);
+    let end = tail.length - 22;
+    while (end >= 0 && tail.readUInt32LE(end) !== 0x06054b50) {
+        end--;
+    }
+    if (end < 0) {
+        throw new Error(`${archivePath} is not a zip or asar archive`);
+    }
+    const count = tail.readUInt16LE(end + 10);
+    const directory = readAt(fd, tail.readUInt32LE(end + 16), tail.readUInt32LE(end + 12));
+
+    // struct ZIP_CENTRAL_DIRECTORY_ENTRY {
+    //    0 uint32 signature = 0x02014b50;
+    //   ..
+    //   10 uint16 method;
+    //   ..
+    //   20 uint32 compressedSize;
+    //   24 uint32 size;
+    //   28 uint16 nameLength;
+    //   30 uint16 extraLength;
+    //   32 uint16 commentLength;
+    //   ..
+    //   42 uint32 localHeaderOffset;
+    //   46 char name[nameLength];
+    //   .. byte extra[extraLength];
+    //   .. char comment[commentLength];
+    // }
+    const entries = new Map();
+    for (let i = 0, pos = 0; i < count; i++) {
+        if (directory.readUInt32LE(pos) !== 0x02014b50) {
+            throw new Error(`Invalid zip central directory in ${archivePath}`);
+        }
+        const nameLength = directory.readUInt16LE(pos + 28);
+        entries.set(directory.toString('utf8', pos + 46, pos + 46 + nameLength), {
+            localOffset: directory.readUInt32LE(pos + 42),
+            method: directory.readUInt16LE(pos + 10),
+            compressedSize: directory.readUInt32LE(pos + 20),
+        });
+        pos += 46 + nameLength + directory.readUInt16LE(pos + 30) + directory.readUInt16LE(pos + 32);
+    }
+    return { entries };
+}
+
 function createMenuTemplate(items) {
     // Generates a MENUEX binary resource structure to be
     // loaded by LoadMenuIndirectW().
@@ -0,0 +1,85 @@
+#include "bounded-text.hh"
+
+#include <algorithm>
+
+static bool is_high_surrogate(wchar_t c) { return c >= 0xD800 && c < 0xDC00; }
+static bool is_low_surrogate(wchar_t c) { return c >= 0xDC00 && c < 0xE000; }
+
+// Whether `text[index]` continues the character before it, so cutting before
+// it would change how that character is shown. Only the common extending
+// ranges are checked, this isn't full grapheme segmentation.
+static bool continues_previous(std::wstring_view text, size_t index) {
+  auto c = text[index];
+  if (index != 0 && text[index - 1] == 0x200D) {
+    return true;
+  }
+  if (is_low_surrogate(c)) {
+    // U+1F3FB to U+1F3FF, emoji skin tone modifiers.
+    return index != 0 && text[index - 1] == 0xD83C && c >= 0xDFFB;
+  }
+  if (is_high_surrogate(c)) {
+    return c == 0xD83C && index + 1 != text.size() &&
+           text[index + 1] >= 0xDFFB && text[index + 1] <= 0xDFFF;
+  }
+  return (c >= 0x0300 && c <= 0x036F) ||  // Combining Diacritical Marks
+         (c >= 0x1AB0 && c <= 0x1AFF) ||  // ... Extended
+         (c >= 0x1DC0 && c <= 0x1DFF) ||  // ... Supplement
+         (c >= 0x20D0 && c <= 0x20FF) ||  // ... for Symbols
+         (c >= 0xFE20 && c <= 0xFE2F) ||  // Combining Half Marks
+         (c >= 0xFE00 && c <= 0xFE0F) ||  // Variation Selectors
+         c == 0x200D;                     // Zero Width Joiner
+}
+
+size_t bounded_text_length(std::wstring_view text, size_t max_length) {
+  if (text.size() <= max_length) {
+    return text.size();
+  }
+  if (max_length == 0) {
+    return 0;
+  }
+  auto length = max_length;
+  // Would leave the high surrogate of a pair.
+  if (length != 0 && is_high_surrogate(text[length - 1]) &&
+      is_low_surrogate(text[length])) {
+    length--;
+  }
+  while (length != 0 && continues_previous(text, length)) {
+    length--;
+    // Back over the rest of a pair.
+    if (length != 0 && is_low_surrogate(text[length]) &&
+        is_high_surrogate(text[length - 1])) {
+      length--;
+    }
+  }
+  // A base character followed by more marks than fit: fall back to the code
+  // point boundary rather than dropping everything.
+  if (length == 0) {
+    length = max_length;
+    if (is_high_surrogate(text[length - 1]) && is_low_surrogate(text[length])) {
+      length--;
+    }
+  }
+  return length;
+}
+
+size_t copy_bounded_text(std::wstring_view text, wchar_t* dest,
+                         size_t capacity, bool ellipsis) {
+  if (capacity == 0) {
+    return 0;
+  }
+  auto max_length = capacity - 1;
+  size_t length;
+  if (text.size() <= max_length) {
+    length = text.size();
+    std::copy_n(text.data(), length, dest);
+  } else if (ellipsis && max_length != 0) {
+    length = bounded_text_length(text, max_length - 1);
+    std::copy_n(text.data(), length, dest);
+    dest[length++] = 0x2026;
+  } else {
+    length = bounded_text_length(text, max_length);
+    std::copy_n(text.data(), length, dest);
+  }
+  dest[length] = 0;
+  return length;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+
+// Length of the longest prefix of `text` that is at most `max_length` UTF-16
+// code units, without splitting a surrogate pair or leaving combining marks,
+// variation selectors, joiners or emoji modifiers without what they modify.
+size_t bounded_text_length(std::wstring_view text, size_t max_length);
+
+// Copies `text` to `dest`, which has room for `capacity` characters including
+// the terminator, truncated by bounded_text_length() and ending with U+2026
+// HORIZONTAL ELLIPSIS if `ellipsis` is set and it didn't fit. Returns the
+// length written, not including the terminator.
+size_t copy_bounded_text(std::wstring_view text, wchar_t* dest,
+                         size_t capacity, bool ellipsis = true);
+
+template <size_t N>
+size_t copy_bounded_text(std::wstring_view text, wchar_t (&dest)[N],
+                         bool ellipsis = true) {
+  return copy_bounded_text(text, dest, N, ellipsis);
+}
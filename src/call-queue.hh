@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// A first in, first out ring of `T`, reusing its slots so pushing and popping
+// don't allocate once it has grown to the most items queued at once. Not
+// synchronized, callers hold their own lock.
+template <typename T>
+class CallQueue {
+ public:
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  void push(T&& item) {
+    if (count == slots.size()) {
+      grow();
+    }
+    slots[(head + count) % slots.size()] = std::move(item);
+    count++;
+  }
+
+  // Returns false if the queue is empty.
+  bool pop(T* result) {
+    if (!count) {
+      return false;
+    }
+    *result = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    count--;
+    return true;
+  }
+
+  void clear() {
+    T item;
+    while (pop(&item)) {
+    }
+  }
+
+ private:
+  void grow() {
+    std::vector<T> grown(slots.empty() ? 16 : slots.size() * 2);
+    for (size_t i = 0; i != count; i++) {
+      grown[i] = std::move(slots[(head + i) % slots.size()]);
+    }
+    slots.swap(grown);
+    head = 0;
+  }
+
+  std::vector<T> slots;
+  size_t head = 0;
+  size_t count = 0;
+};
@@ -0,0 +1,173 @@
+#include "command-ring.hh"
+
+#include <unordered_map>
+
+#include "notify-icon-object.hh"
+
+static std::mutex rings_mutex;
+static int32_t last_ring_id = 0;
+static std::unordered_map<int32_t, std::shared_ptr<CommandRing>> rings;
+
+std::shared_ptr<CommandRing> create_command_ring(
+    HWND hwnd, std::shared_ptr<NotifyIconShell> shell, int32_t* data,
+    uint32_t capacity, std::vector<notify_icon_prepared_modify> states,
+    std::vector<std::wstring> tooltips) {
+  std::lock_guard lock{rings_mutex};
+  auto ring = std::make_shared<CommandRing>(
+      ++last_ring_id, hwnd, std::move(shell), data, capacity,
+      std::move(states), std::move(tooltips));
+  rings.insert({ring->id, ring});
+  return ring;
+}
+
+std::shared_ptr<CommandRing> find_command_ring(int32_t id) {
+  std::lock_guard lock{rings_mutex};
+  if (auto it = rings.find(id); it != rings.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
+void release_command_ring(int32_t id) {
+  std::shared_ptr<CommandRing> ring;
+  {
+    std::lock_guard lock{rings_mutex};
+    if (auto it = rings.find(id); it != rings.end()) {
+      ring = std::move(it->second);
+      rings.erase(it);
+    }
+  }
+  if (ring) {
+    ring->close();
+  }
+}
+
+void release_command_rings(const NotifyIconShell* shell) {
+  std::vector<std::shared_ptr<CommandRing>> released;
+  {
+    std::lock_guard lock{rings_mutex};
+    for (auto it = rings.begin(); it != rings.end();) {
+      if (it->second->shell.get() == shell) {
+        released.push_back(std::move(it->second));
+        it = rings.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  for (auto& ring : released) {
+    ring->close();
+  }
+}
+
+// Int32Array elements are plain aligned int32s, so they can be used as
+// lock-free atomics shared with JS's Atomics.
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t));
+static_assert(std::atomic<int32_t>::is_always_lock_free);
+
+CommandRing::CommandRing(int32_t id, HWND hwnd,
+                         std::shared_ptr<NotifyIconShell> shell,
+                         int32_t* data, uint32_t capacity,
+                         std::vector<notify_icon_prepared_modify> states,
+                         std::vector<std::wstring> tooltips)
+    : id{id},
+      shell{std::move(shell)},
+      hwnd{hwnd},
+      header{reinterpret_cast<std::atomic<int32_t>*>(data)},
+      capacity{capacity},
+      states{std::move(states)},
+      tooltips{std::move(tooltips)} {}
+
+bool CommandRing::wake() {
+  std::lock_guard lock{mutex};
+  if (!header) {
+    return false;
+  }
+  counts.wakes++;
+  if (!woken_at) {
+    woken_at = clock::now();
+  }
+  PostMessageW(hwnd, WM_USER_COMMAND_RING, (WPARAM)id, 0);
+  return true;
+}
+
+void CommandRing::drain() {
+  std::lock_guard lock{mutex};
+  if (!header) {
+    return;
+  }
+  // Before reading, so a command written after this wakes us again.
+  header[command_ring_wake] = 0;
+
+  auto slots = header + command_ring_header_size;
+  auto read = (uint32_t)header[command_ring_read].load();
+  std::optional<uint32_t> state;
+  std::optional<uint32_t> tooltip;
+  std::optional<bool> hidden;
+  uint64_t applied = 0;
+  for (;; read++) {
+    auto& slot = slots[read & (capacity - 1)];
+    // Empty, or reserved and not written yet, in which case its writer will
+    // wake us again.
+    auto command = (uint32_t)slot.load();
+    if (!command) {
+      break;
+    }
+    slot = 0;
+    applied++;
+
+    if (auto index = command & 0xfff; index && index <= states.size()) {
+      state = index - 1;
+      // The state replaces any earlier tooltip or hidden command it sets.
+      auto& options = states[index - 1].options;
+      if (options.tooltip) tooltip.reset();
+      if (options.hidden) hidden.reset();
+    }
+    if (auto index = (command >> 12) & 0xfff;
+        index && index <= tooltips.size()) {
+      tooltip = index - 1;
+    }
+    if (auto show = (command >> 24) & 3; show) {
+      hidden = show == 2;
+    }
+  }
+  header[command_ring_read] = (int32_t)read;
+
+  counts.applied += applied;
+  counts.drains++;
+  if (woken_at) {
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock::now() - woken_at.value());
+    counts.total_latency += latency;
+    counts.max_latency = std::max(counts.max_latency, latency);
+    woken_at.reset();
+  }
+
+  if (!applied) {
+    return;
+  }
+  std::lock_guard shell_lock{shell->mutex};
+  // Removed since.
+  if (!shell->icon.id) {
+    return;
+  }
+  if (state) {
+    shell->modify(states[state.value()]);
+  }
+  if (tooltip || hidden) {
+    notify_icon_options options;
+    if (tooltip) options.tooltip = tooltips[tooltip.value()];
+    options.hidden = hidden;
+    shell->modify(std::move(options));
+  }
+}
+
+void CommandRing::close() {
+  std::lock_guard lock{mutex};
+  header = nullptr;
+}
+
+CommandRing::stats CommandRing::get_stats() {
+  std::lock_guard lock{mutex};
+  return counts;
+}
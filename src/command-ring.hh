@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "notify-icon.hh"
+
+struct NotifyIconShell;
+
+// Posted to a notify icon message window with the ring id as wParam when a
+// ring has commands waiting.
+constexpr auto WM_USER_COMMAND_RING = WM_USER + 4;
+
+// Layout of the ring's SharedArrayBuffer as Int32Array elements, shared with
+// CommandRing in index.js: these header fields, then `capacity` slots.
+enum command_ring_field : int32_t {
+  // Next slot to reserve, advanced by writers with compareExchange.
+  command_ring_write,
+  // Next slot to drain, advanced by the message thread.
+  command_ring_read,
+  // Set by the writer that wakes the message thread, cleared before draining.
+  command_ring_wake,
+  // Commands that didn't fit.
+  command_ring_dropped,
+  command_ring_header_size,
+};
+
+// A slot is 0 while empty or reserved, otherwise a command:
+//   bits 0-11: state index + 1, or 0 to leave the state
+//   bits 12-23: tooltip index + 1, or 0 to leave the tooltip
+//   bits 24-25: 1 to show, 2 to hide, or 0 to leave as is
+constexpr uint32_t command_ring_max_choices = 0xfff;
+
+// Updates to a notify icon written by any thread, e.g. worker_threads, into a
+// lock-free ring in a SharedArrayBuffer, and applied by its message thread
+// without going through the JS thread that owns the icon. Commands can only
+// pick from states and tooltips given when the ring is created, so they fit in
+// a single word. Registered process-wide by id, like IconSurface.
+struct CommandRing {
+  using clock = std::chrono::steady_clock;
+
+  const int32_t id;
+  const std::shared_ptr<NotifyIconShell> shell;
+
+  struct stats {
+    uint64_t applied = 0;
+    uint64_t wakes = 0;
+    uint64_t drains = 0;
+    // From the first wake() to the drain that handled it.
+    std::chrono::microseconds total_latency{};
+    std::chrono::microseconds max_latency{};
+  };
+
+  // `slots` is `capacity` (a power of two) int32 elements following the
+  // header, and must stay alive until close().
+  CommandRing(int32_t id, HWND hwnd, std::shared_ptr<NotifyIconShell> shell,
+              int32_t* data, uint32_t capacity,
+              std::vector<notify_icon_prepared_modify> states,
+              std::vector<std::wstring> tooltips);
+
+  // Can be called from any thread, after writing commands. Returns false if
+  // the ring has been closed.
+  bool wake();
+  // On the message thread, in response to WM_USER_COMMAND_RING. Only the net
+  // effect of the commands waiting is sent to the shell.
+  void drain();
+  // Stops reading the buffer, so it can be released.
+  void close();
+
+  stats get_stats();
+
+ private:
+  std::mutex mutex;
+  HWND hwnd;
+  std::atomic<int32_t>* header;
+  uint32_t capacity;
+  std::vector<notify_icon_prepared_modify> states;
+  std::vector<std::wstring> tooltips;
+  std::optional<clock::time_point> woken_at;
+  stats counts;
+};
+
+std::shared_ptr<CommandRing> create_command_ring(
+    HWND hwnd, std::shared_ptr<NotifyIconShell> shell, int32_t* data,
+    uint32_t capacity, std::vector<notify_icon_prepared_modify> states,
+    std::vector<std::wstring> tooltips);
+// Returns nullptr if the ring has been released.
+std::shared_ptr<CommandRing> find_command_ring(int32_t id);
+// Closes and unregisters the ring.
+void release_command_ring(int32_t id);
+// Closes and unregisters every ring applying commands to `shell`.
+void release_command_rings(const NotifyIconShell* shell);
@@ -1,4 +1,7 @@
 #include "data.hh"
+#include "command-ring.hh"
+#include "icon-object.hh"
+#include "icon-surface.hh"
 #include "notify-icon-object.hh"
 
 #include <map>
@@ -20,6 +23,32 @@ EnvData* get_env_data(napi_env env) {
   return nullptr;
 }
 
+// The environment owning each icon, to route messages from the message thread
+// shared by every environment. Icon ids are unique across the process.
+static std::mutex icon_envs_mutex;
+static std::unordered_map<int32_t, napi_env> icon_envs;
+
+EnvDataLock lock_env_data(napi_env env) {
+  EnvDataLock result{std::unique_lock{env_datas_mutex}};
+  if (auto it = env_datas.find(env); it != env_datas.end()) {
+    result.data = &it->second;
+  }
+  return result;
+}
+
+EnvDataLock lock_icon_env_data(int32_t icon_id) {
+  napi_env env;
+  {
+    std::lock_guard lock{icon_envs_mutex};
+    if (auto it = icon_envs.find(icon_id); it != icon_envs.end()) {
+      env = it->second;
+    } else {
+      return {};
+    }
+  }
+  return lock_env_data(env);
+}
+
 napi_status EnvData::add_icon(int32_t id, napi_value value,
                               NotifyIconObject* object) {
   // std::lock_guard icons_lock{icons_mutex};
@@ -31,13 +60,20 @@ napi_status EnvData::add_icon(int32_t id, napi_value value,
   NapiRef ref;
   NAPI_RETURN_IF_NOT_OK(ref.create(env, value));
   auto insert = icons.insert({id,
-                              {ref.ref, object->notify_icon.id.callback_id,
-                               object->notify_icon.id.guid}});
+                              {ref.ref, object->display_id.callback_id,
+                               object->display_id.guid}});
   // If the insert succeeded, don't unref
   if (insert.second) {
     ref.release();
   }
 
+  {
+    std::lock_guard icon_envs_lock{icon_envs_mutex};
+    icon_envs.insert({id, env});
+  }
+
+  std::lock_guard shells_lock{shells_mutex};
+  shells.insert({id, object->shell});
   return napi_ok;
 }
 
@@ -50,6 +86,14 @@ bool EnvData::remove_icon(int32_t id) {
       return false;
     } else {
       icons.erase(it);
+      {
+        std::lock_guard shells_lock{shells_mutex};
+        shells.erase(id);
+      }
+      {
+        std::lock_guard icon_envs_lock{icon_envs_mutex};
+        icon_envs.erase(id);
+      }
       if (icons.empty()) {
         icon_message_loop.quit();
         // ::PostMessageW(msg_hwnd, WM_USER_QUIT, 0, 0);
@@ -60,39 +104,219 @@ bool EnvData::remove_icon(int32_t id) {
   return true;
 }
 
+std::vector<std::shared_ptr<NotifyIconShell>> EnvData::get_shells() {
+  std::vector<std::shared_ptr<NotifyIconShell>> result;
+  std::lock_guard lock{shells_mutex};
+  for (auto& [id, weak_shell] : shells) {
+    if (auto shell = weak_shell.lock()) {
+      result.push_back(std::move(shell));
+    }
+  }
+  return result;
+}
+
+void EnvData::detach_message_thread() {
+  auto detached = get_shells();
+  auto detach = [&] {
+    for (auto& shell : detached) {
+      release_command_rings(shell.get());
+      shell->detach();
+    }
+  };
+
+  // Without icons this environment isn't keeping the message thread running,
+  // and the timers it set are for removed icons, whose shells are already
+  // detached.
+  if (!icon_message_loop.hwnd) {
+    detach();
+    return;
+  }
+  // On the message thread, so nothing is using them once this returns.
+  icon_message_loop.run_on_msg_thread_blocking([&] {
+    detach();
+    icon_message_loop.kill_timers();
+  });
+}
+
+void restore_all_icons(HWND hwnd) {
+  // Restored without the lock, as the shells may be busy.
+  std::vector<std::shared_ptr<NotifyIconShell>> shells;
+  {
+    std::lock_guard lock{env_datas_mutex};
+    for (auto& [env, data] : env_datas) {
+      auto env_shells = data.get_shells();
+      shells.insert(shells.end(), env_shells.begin(), env_shells.end());
+    }
+  }
+  // Detached shells, of environments torn down since, aren't restored.
+  for (auto& shell : shells) {
+    shell->restore();
+  }
+  // Their icons may be newer than what the shell was last sent.
+  republish_icon_surfaces(hwnd);
+}
+
+void EnvData::touch_icon(IconObject* object) {
+  if (object->resident) {
+    resident_icons.splice(resident_icons.begin(), resident_icons,
+                          object->resident_it);
+  } else {
+    object->resident_it = resident_icons.insert(resident_icons.begin(), object);
+    object->resident = true;
+  }
+}
+
+void EnvData::forget_icon(IconObject* object) {
+  if (object->resident) {
+    resident_icons.erase(object->resident_it);
+    object->resident = false;
+  }
+}
+
+void EnvData::trim_icons() {
+  if (!icon_handle_budget) {
+    return;
+  }
+
+  auto it = resident_icons.end();
+  while (resident_icons.size() > icon_handle_budget &&
+         it != resident_icons.begin()) {
+    auto object = *--it;
+    if (object->pins) {
+      continue;
+    }
+    if (object->evict()) {
+      object->resident = false;
+      it = resident_icons.erase(it);
+      evicted_icon_count++;
+    }
+  }
+}
+
 void EnvData::notify_select(int32_t icon_id, NotifySelectArgs args) {
-  icon_message_loop.run_on_env_thread.blocking([=](napi_env env, napi_value) {
-    NAPI_FATAL_IF(this->env != env);
-
-    napi_ref ref;
-    {
-      // std::lock_guard icons_lock{env_data->icons_mutex};
-      if (auto it = icons.find(icon_id); it != icons.end()) {
-        ref = it->second.ref;
-      } else {
-        return;
-      }
+  icon_message_loop.post_to_env_thread(
+      [=](napi_env env) {
+        NAPI_FATAL_IF(this->env != env);
+
+        napi_ref ref;
+        {
+          // std::lock_guard icons_lock{env_data->icons_mutex};
+          if (auto it = icons.find(icon_id); it != icons.end()) {
+            ref = it->second.ref;
+          } else {
+            return;
+          }
+        }
+
+        napi_value value;
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(
+            env, napi_get_reference_value(env, ref, &value));
+
+        NotifyIconObject* object;
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(env,
+                                         napi_get_value(env, value, &object));
+
+        napi_value event;
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(
+            env, napi_create_object(env, &event,
+                                    {
+                                        {"target", value},
+                                        {"rightButton", args.right_button},
+                                        {"mouseX", args.mouse_x},
+                                        {"mouseY", args.mouse_y},
+                                    }));
+
+        object->select_callback(value, {event});
+      },
+      NotifyIconMessageLoop::droppable);
+}
+
+void EnvData::notify_event(NotifyEventArgs args) {
+  std::shared_ptr<NotifyIconShell> shell;
+  {
+    std::lock_guard lock{shells_mutex};
+    if (auto it = shells.find(args.icon_id); it != shells.end()) {
+      shell = it->second.lock();
+    }
+  }
+  // Never wake JS for events nobody is listening to.
+  if (!shell || !(shell->event_mask & args.type)) {
+    return;
+  }
+
+  auto pushed = shell->push_event(args);
+  {
+    std::lock_guard lock{events_mutex};
+    merged_event_count += pushed.merged;
+    dropped_event_count += pushed.dropped;
+    if (!pushed.wake) {
+      return;
+    }
+    woken_icons.push_back(args.icon_id);
+    if (std::exchange(events_scheduled, true)) {
+      return;
+    }
+  }
+
+  icon_message_loop.post_to_env_thread(
+      [=](napi_env env) {
+        NAPI_FATAL_IF(this->env != env);
+        deliver_events();
+      },
+      NotifyIconMessageLoop::required);
+}
+
+void EnvData::deliver_events() {
+  std::vector<int32_t> woken;
+  {
+    std::lock_guard lock{events_mutex};
+    woken.swap(woken_icons);
+    events_scheduled = false;
+    event_batch_count++;
+  }
+
+  for (auto icon_id : woken) {
+    // Removed since.
+    auto it = icons.find(icon_id);
+    if (it == icons.end()) {
+      continue;
     }
 
     napi_value value;
     NAPI_THROW_RETURN_VOID_IF_NOT_OK(
-        env, napi_get_reference_value(env, ref, &value));
+        env, napi_get_reference_value(env, it->second.ref, &value));
 
     NotifyIconObject* object;
     NAPI_THROW_RETURN_VOID_IF_NOT_OK(env, napi_get_value(env, value, &object));
 
-    napi_value event;
-    NAPI_THROW_RETURN_VOID_IF_NOT_OK(
-        env, napi_create_object(env, &event,
-                                {
-                                    {"target", value},
-                                    {"rightButton", args.right_button},
-                                    {"mouseX", args.mouse_x},
-                                    {"mouseY", args.mouse_y},
-                                }));
-
-    object->select_callback(value, {event});
-  });
+    NAPI_THROW_RETURN_VOID_IF_NOT_OK(env, object->events_woken(env, value));
+  }
+}
+
+void EnvData::notify_tooltip_request(int32_t icon_id) {
+  icon_message_loop.post_to_env_thread(
+      [=](napi_env env) {
+        NAPI_FATAL_IF(this->env != env);
+
+        napi_ref ref;
+        if (auto it = icons.find(icon_id); it != icons.end()) {
+          ref = it->second.ref;
+        } else {
+          return;
+        }
+
+        napi_value value;
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(
+            env, napi_get_reference_value(env, ref, &value));
+
+        NotifyIconObject* object;
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(env,
+                                         napi_get_value(env, value, &object));
+
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(env,
+                                         object->request_tooltip(env, value));
+      },
+      NotifyIconMessageLoop::droppable);
 }
 
 template <typename Fn>
@@ -104,6 +328,21 @@ napi_status napi_add_env_cleanup_hook(napi_env env, Fn fn) {
   return napi_ok;
 }
 
+static void destroy_env_data(napi_env env) {
+  // Before taking the lock, as the message thread may be waiting on it.
+  if (auto data = get_env_data(env)) {
+    data->detach_message_thread();
+  }
+
+  decltype(env_datas)::node_type node;
+  {
+    std::lock_guard lock{env_datas_mutex};
+    node = env_datas.extract(env);
+  }
+  // This will also fire all the required destructors, after unlocking, as
+  // stopping the message thread waits for it.
+}
+
 std::tuple<napi_status, EnvData*> create_env_data(napi_env env) {
   // Lock for the whole method just so we know we'll get
   // a consistent EnvData.
@@ -111,19 +350,13 @@ std::tuple<napi_status, EnvData*> create_env_data(napi_env env) {
   auto data = &env_datas[env];
   data->env = env;
 
-  if (auto status = data->icon_message_loop.run_on_env_thread.create(env);
+  if (auto status = data->icon_message_loop.create_env_queue(env);
       status != napi_ok) {
     return {status, nullptr};
   }
 
   if (auto status =
-          napi_add_env_cleanup_hook(env,
-                                    [=] {
-                                      std::lock_guard lock{env_datas_mutex};
-                                      // This will also fire all the required
-                                      // destructors.
-                                      env_datas.erase(env);
-                                    });
+          napi_add_env_cleanup_hook(env, [=] { destroy_env_data(env); });
       status != napi_ok) {
     return {status, nullptr};
   }
@@ -132,6 +365,12 @@ std::tuple<napi_status, EnvData*> create_env_data(napi_env env) {
 }
 
 EnvData::~EnvData() {
+  {
+    std::lock_guard lock{icon_envs_mutex};
+    for (auto& pair : icons) {
+      icon_envs.erase(pair.first);
+    }
+  }
   for (auto& pair : icons) {
     delete_notify_icon(
         {icon_message_loop.hwnd, pair.second.id, pair.second.guid});
@@ -3,7 +3,26 @@
 #include "napi/napi.hh"
 #include "notify-icon-message-loop.hh"
 
+#include <list>
+#include <memory>
+#include <mutex>
+
+struct IconObject;
 struct NotifyIconObject;
+struct NotifyIconShell;
+
+// Shell events other than select, as bits of NotifyIconShell::event_mask.
+enum notify_icon_event : uint32_t {
+  notify_icon_event_mouse_move = 1 << 0,
+  notify_icon_event_balloon_show = 1 << 1,
+  notify_icon_event_balloon_hide = 1 << 2,
+  notify_icon_event_balloon_timeout = 1 << 3,
+  notify_icon_event_balloon_click = 1 << 4,
+  notify_icon_event_popup_open = 1 << 5,
+  notify_icon_event_popup_close = 1 << 6,
+  notify_icon_event_select = 1 << 7,
+  notify_icon_event_all = (1 << 8) - 1,
+};
 
 struct EnvData {
   struct IconData {
@@ -22,8 +41,41 @@ struct EnvData {
   std::unordered_map<int32_t, IconData> icons;
   NotifyIconMessageLoop icon_message_loop;
 
+  // The last state sent for each icon, kept by its shell, so the message thread
+  // can add them all again when the taskbar is recreated without waiting on JS.
+  std::mutex shells_mutex;
+  std::unordered_map<int32_t, std::weak_ptr<NotifyIconShell>> shells;
+
+  // Icons owning a handle, most recently used first. When there are more than
+  // icon_handle_budget (if not 0), the least recently used that are not being
+  // shown are evicted, to be recreated on next use.
+  std::list<IconObject*> resident_icons;
+  size_t icon_handle_budget = 0;
+  uint64_t evicted_icon_count = 0;
+  uint64_t rematerialized_icon_count = 0;
+
+  // NotifyIcon updates are merged per icon while a batch is open, either
+  // explicitly or until the end of the current tick if auto_batch is set,
+  // then flushed as a single modify per icon.
+  int32_t batch_depth = 0;
+  bool auto_batch = false;
+  bool auto_batch_scheduled = false;
+  std::vector<NapiRef> batched_notify_icons;
+  uint64_t notify_icon_update_count = 0;
+  uint64_t notify_icon_modify_count = 0;
+
+  void touch_icon(IconObject* object);
+  void forget_icon(IconObject* object);
+  void trim_icons();
+
   napi_status add_icon(int32_t id, napi_value value, NotifyIconObject* object);
   bool remove_icon(int32_t id);
+  // The shells of the icons added, kept alive for use without shells_mutex.
+  std::vector<std::shared_ptr<NotifyIconShell>> get_shells();
+  // As the environment is torn down, before it's destroyed, stops the message
+  // thread, which outlives it, using anything it owns: its shells are
+  // detached, their command rings released and its timers killed.
+  void detach_message_thread();
 
   struct NotifySelectArgs {
     bool right_button = false;
@@ -32,9 +84,51 @@ struct EnvData {
   };
   void notify_select(int32_t id, NotifySelectArgs args);
 
+  struct NotifyEventArgs {
+    int32_t icon_id = 0;
+    notify_icon_event type = notify_icon_event_mouse_move;
+    bool right_button = false;
+    int32_t mouse_x = 0;
+    int32_t mouse_y = 0;
+  };
+  // Events for icons subscribed to them are buffered by each icon's shell on
+  // the message thread, then the JS thread is woken once for all the icons
+  // that have new events, see NotifyIconShell::push_event().
+  std::mutex events_mutex;
+  std::vector<int32_t> woken_icons;
+  bool events_scheduled = false;
+  uint64_t delivered_event_count = 0;
+  uint64_t merged_event_count = 0;
+  uint64_t dropped_event_count = 0;
+  uint64_t event_batch_count = 0;
+  void notify_event(NotifyEventArgs args);
+  void deliver_events();
+  // The user is hovering over the icon, so its tooltip may be needed.
+  void notify_tooltip_request(int32_t id);
+
   ~EnvData();
 };
 
 EnvData* get_env_data(napi_env env);
 
+// An environment's data, kept from being destroyed by its cleanup hook while
+// used off its JS thread. The lock is shared by every environment, so hold it
+// briefly, and never while getting another.
+struct EnvDataLock {
+  std::unique_lock<std::mutex> lock;
+  EnvData* data = nullptr;
+
+  explicit operator bool() const { return data != nullptr; }
+  EnvData* operator->() const { return data; }
+};
+
+// Can be called from any thread.
+EnvDataLock lock_env_data(napi_env env);
+// The data of the environment owning the notify icon with `icon_id`, if any.
+// Can be called from any thread.
+EnvDataLock lock_icon_env_data(int32_t icon_id);
+// On the message thread, after the taskbar has been recreated, restores the
+// notify icons of every environment.
+void restore_all_icons(HWND hwnd);
+
 std::tuple<napi_status, EnvData*> create_env_data(napi_env env);
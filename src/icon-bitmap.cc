@@ -0,0 +1,281 @@
+#include "icon-bitmap.hh"
+
+#include <wincodec.h>
+
+template <typename T>
+void com_release(T* ptr) {
+  if (ptr) ptr->Release();
+}
+
+template <typename T>
+using ComPtr = Unique<T*, com_release<T>>;
+
+// The node main thread may or may not already have COM initialized, and in
+// either apartment model, WIC doesn't care, so just make sure it's been
+// initialized somehow for the duration of the call.
+struct ComInit {
+  HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+  ~ComInit() {
+    if (SUCCEEDED(hr)) CoUninitialize();
+  }
+};
+
+static icon_bitmap_error convert(IWICImagingFactory* factory,
+                                 IWICBitmapSource* source,
+                                 REFWICPixelFormatGUID format,
+                                 ComPtr<IWICFormatConverter>* result) {
+  if (auto hr = factory->CreateFormatConverter(&result->value); FAILED(hr)) {
+    return {"IWICImagingFactory::CreateFormatConverter", hr};
+  }
+
+  if (auto hr = result->value->Initialize(source, format,
+                                          WICBitmapDitherTypeNone, nullptr,
+                                          0.0, WICBitmapPaletteTypeCustom);
+      FAILED(hr)) {
+    return {"IWICFormatConverter::Initialize", hr};
+  }
+  return {};
+}
+
+static icon_bitmap_error decode_frame(IWICImagingFactory* factory,
+                                      IWICBitmapDecoder* decoder,
+                                      IconBitmap* result, int32_t scale_width,
+                                      int32_t scale_height) {
+  ComPtr<IWICBitmapFrameDecode> frame;
+  if (auto hr = decoder->GetFrame(0, &frame.value); FAILED(hr)) {
+    return {"IWICBitmapDecoder::GetFrame", hr};
+  }
+
+  UINT width = 0, height = 0;
+  if (auto hr = frame.value->GetSize(&width, &height); FAILED(hr)) {
+    return {"IWICBitmapSource::GetSize", hr};
+  }
+
+  ComPtr<IWICFormatConverter> converter;
+  if (scale_width && scale_height &&
+      (width != (UINT)scale_width || height != (UINT)scale_height)) {
+    // Scale premultiplied, so transparent pixels don't bleed into the edges.
+    ComPtr<IWICFormatConverter> premultiplied;
+    if (auto error = convert(factory, frame, GUID_WICPixelFormat32bppPBGRA,
+                             &premultiplied)) {
+      return error;
+    }
+
+    ComPtr<IWICBitmapScaler> scaler;
+    if (auto hr = factory->CreateBitmapScaler(&scaler.value); FAILED(hr)) {
+      return {"IWICImagingFactory::CreateBitmapScaler", hr};
+    }
+    width = (UINT)scale_width;
+    height = (UINT)scale_height;
+    if (auto hr = scaler.value->Initialize(premultiplied, width, height,
+                                           WICBitmapInterpolationModeFant);
+        FAILED(hr)) {
+      return {"IWICBitmapScaler::Initialize", hr};
+    }
+
+    if (auto error = convert(factory, scaler, GUID_WICPixelFormat32bppBGRA,
+                             &converter)) {
+      return error;
+    }
+  } else if (auto error = convert(factory, frame, GUID_WICPixelFormat32bppBGRA,
+                                  &converter)) {
+    return error;
+  }
+
+  result->width = (int32_t)width;
+  result->height = (int32_t)height;
+  result->pixels.resize((size_t)width * height);
+  if (auto hr = converter.value->CopyPixels(
+          nullptr, width * 4, (UINT)(result->pixels.size() * 4),
+          (BYTE*)result->pixels.data());
+      FAILED(hr)) {
+    return {"IWICBitmapSource::CopyPixels", hr};
+  }
+
+  return {};
+}
+
+static icon_bitmap_error create_factory(ComPtr<IWICImagingFactory>* result) {
+  if (auto hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
+                                 CLSCTX_INPROC_SERVER,
+                                 IID_PPV_ARGS(&result->value));
+      FAILED(hr)) {
+    return {"CoCreateInstance", hr};
+  }
+  return {};
+}
+
+icon_bitmap_error decode_image_file(LPCWSTR path, IconBitmap* result) {
+  ComInit com_init;
+
+  ComPtr<IWICImagingFactory> factory;
+  if (auto error = create_factory(&factory)) {
+    return error;
+  }
+
+  ComPtr<IWICBitmapDecoder> decoder;
+  if (auto hr = factory.value->CreateDecoderFromFilename(
+          path, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand,
+          &decoder.value);
+      FAILED(hr)) {
+    return {"IWICImagingFactory::CreateDecoderFromFilename", hr};
+  }
+
+  return decode_frame(factory, decoder, result, 0, 0);
+}
+
+icon_bitmap_error decode_image_memory(const void* data, size_t size,
+                                      IconBitmap* result, int32_t scale_width,
+                                      int32_t scale_height) {
+  ComInit com_init;
+
+  ComPtr<IWICImagingFactory> factory;
+  if (auto error = create_factory(&factory)) {
+    return error;
+  }
+
+  ComPtr<IWICStream> stream;
+  if (auto hr = factory.value->CreateStream(&stream.value); FAILED(hr)) {
+    return {"IWICImagingFactory::CreateStream", hr};
+  }
+
+  // Only reads from the buffer, despite the signature.
+  if (auto hr = stream.value->InitializeFromMemory((BYTE*)data, (DWORD)size);
+      FAILED(hr)) {
+    return {"IWICStream::InitializeFromMemory", hr};
+  }
+
+  ComPtr<IWICBitmapDecoder> decoder;
+  if (auto hr = factory.value->CreateDecoderFromStream(
+          stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder.value);
+      FAILED(hr)) {
+    return {"IWICImagingFactory::CreateDecoderFromStream", hr};
+  }
+
+  return decode_frame(factory, decoder, result, scale_width, scale_height);
+}
+
+icon_bitmap_error IconCanvas::create(int32_t new_width, int32_t new_height) {
+  BITMAPINFO info = {};
+  info.bmiHeader.biSize = sizeof(info.bmiHeader);
+  info.bmiHeader.biWidth = new_width;
+  info.bmiHeader.biHeight = -new_height;  // top-down
+  info.bmiHeader.biPlanes = 1;
+  info.bmiHeader.biBitCount = 32;
+  info.bmiHeader.biCompression = BI_RGB;
+
+  void* new_bits = nullptr;
+  color = CreateDIBSection(nullptr, &info, DIB_RGB_COLORS, &new_bits, nullptr,
+                           0);
+  if (!color) {
+    return {"CreateDIBSection", (HRESULT)GetLastError()};
+  }
+
+  // Ignored when the color bitmap has alpha, but it's still required. Rows are
+  // padded to 16 bits.
+  std::vector<uint8_t> mask_bits((size_t)(new_width + 15) / 16 * 2 *
+                                 new_height);
+  mask = CreateBitmap(new_width, new_height, 1, 1, mask_bits.data());
+  if (!mask) {
+    return {"CreateBitmap", (HRESULT)GetLastError()};
+  }
+
+  width = new_width;
+  height = new_height;
+  bits = static_cast<uint32_t*>(new_bits);
+  return {};
+}
+
+icon_bitmap_error IconCanvas::create_icon(HICON* result) const {
+  ICONINFO icon_info = {};
+  icon_info.fIcon = TRUE;
+  icon_info.hbmMask = mask;
+  icon_info.hbmColor = color;
+  // Copies the bitmaps, so they can be changed or freed after.
+  *result = CreateIconIndirect(&icon_info);
+  if (!*result) {
+    return {"CreateIconIndirect", (HRESULT)GetLastError()};
+  }
+
+  return {};
+}
+
+icon_bitmap_error create_icon(const IconBitmapView& view, HICON* result) {
+  IconCanvas canvas;
+  if (auto error = canvas.create(view.width, view.height)) {
+    return error;
+  }
+
+  for (int32_t y = 0; y != view.height; y++) {
+    auto src = view.bitmap->row(view.y + y) + view.x;
+    std::copy(src, src + view.width, canvas.row(y));
+  }
+
+  return canvas.create_icon(result);
+}
+
+using DCHandle = Unique<HDC, DeleteDC>;
+
+static bool get_bitmap_bits(HDC dc, HBITMAP bitmap, IconBitmap* result) {
+  BITMAPINFO info = {};
+  info.bmiHeader.biSize = sizeof(info.bmiHeader);
+  info.bmiHeader.biWidth = result->width;
+  info.bmiHeader.biHeight = -result->height;  // top-down
+  info.bmiHeader.biPlanes = 1;
+  info.bmiHeader.biBitCount = 32;
+  info.bmiHeader.biCompression = BI_RGB;
+  return GetDIBits(dc, bitmap, 0, (UINT)result->height, result->pixels.data(),
+                   &info, DIB_RGB_COLORS) != 0;
+}
+
+icon_bitmap_error snapshot_icon(HICON icon, IconBitmap* result) {
+  ICONINFO icon_info = {};
+  if (!GetIconInfo(icon, &icon_info)) {
+    return {"GetIconInfo", (HRESULT)GetLastError()};
+  }
+  // GetIconInfo() creates copies we own.
+  BitmapHandle color = icon_info.hbmColor;
+  BitmapHandle mask = icon_info.hbmMask;
+  if (!color) {
+    // Monochrome icon, not worth supporting.
+    return {"GetIconInfo", ERROR_NOT_SUPPORTED};
+  }
+
+  BITMAP color_info = {};
+  if (!GetObject(color, sizeof(color_info), &color_info)) {
+    return {"GetObject", (HRESULT)GetLastError()};
+  }
+
+  DCHandle dc = CreateCompatibleDC(nullptr);
+  if (!dc) {
+    return {"CreateCompatibleDC", (HRESULT)GetLastError()};
+  }
+
+  result->width = color_info.bmWidth;
+  result->height = color_info.bmHeight;
+  result->pixels.resize((size_t)result->width * result->height);
+  if (!get_bitmap_bits(dc, color, result)) {
+    return {"GetDIBits", (HRESULT)GetLastError()};
+  }
+
+  for (auto pixel : result->pixels) {
+    if (pixel >> 24) {
+      return {};
+    }
+  }
+
+  // No alpha channel, so the mask decides: set bits are transparent.
+  IconBitmap mask_bitmap;
+  mask_bitmap.width = result->width;
+  mask_bitmap.height = result->height;
+  mask_bitmap.pixels.resize(result->pixels.size());
+  if (!get_bitmap_bits(dc, mask, &mask_bitmap)) {
+    return {"GetDIBits", (HRESULT)GetLastError()};
+  }
+  for (size_t i = 0; i != result->pixels.size(); i++) {
+    auto& pixel = result->pixels[i];
+    pixel = mask_bitmap.pixels[i] & 0xffffff ? 0 : pixel | 0xff000000;
+  }
+  return {};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "icon-pixels.hh"
+#include "unique.hh"
+
+// Win32 call that failed, in the form napi_throw_win32_error() wants.
+struct icon_bitmap_error {
+  const char* syscall = nullptr;
+  HRESULT code = 0;
+
+  explicit operator bool() const { return syscall != nullptr; }
+};
+
+using BitmapHandle = Unique<HBITMAP, DeleteObject>;
+
+// A persistent 32bpp DIB section and mask to create icons from, so pixels that
+// are updated repeatedly only need to copy what changed.
+struct IconCanvas {
+  int32_t width = 0;
+  int32_t height = 0;
+  // Top-down rows of straight alpha BGRA, owned by `color`.
+  uint32_t* bits = nullptr;
+  BitmapHandle color;
+  BitmapHandle mask;
+
+  uint32_t* row(int32_t y) const { return bits + (size_t)y * width; }
+
+  icon_bitmap_error create(int32_t new_width, int32_t new_height);
+  // Creates an owned icon handle from the current contents.
+  icon_bitmap_error create_icon(HICON* result) const;
+};
+
+// Decodes the first frame of any image format WIC supports, e.g. PNG.
+icon_bitmap_error decode_image_file(LPCWSTR path, IconBitmap* result);
+// As above, scaling to `scale_width` x `scale_height` if they are not 0.
+icon_bitmap_error decode_image_memory(const void* data, size_t size,
+                                      IconBitmap* result,
+                                      int32_t scale_width = 0,
+                                      int32_t scale_height = 0);
+
+// Creates an owned icon handle (to be destroyed with DestroyIcon()) from the
+// pixels of the view.
+icon_bitmap_error create_icon(const IconBitmapView& view, HICON* result);
+
+// Reads back the pixels of an existing color icon, using the mask for alpha if
+// the color bitmap has none, so it can be recreated with create_icon().
+icon_bitmap_error snapshot_icon(HICON icon, IconBitmap* result);
@@ -1,7 +1,14 @@
 #include "icon-object.hh"
 
+#include "icon-watcher.hh"
+#include "stock-icons.hh"
+#include "svg-raster.hh"
 #include "unique.hh"
 
+#include <algorithm>
+#include <list>
+#include <mutex>
+
 napi_status napi_get_value(napi_env env, napi_value value,
                            icon_size_t* result) {
   NAPI_RETURN_IF_NOT_OK(
@@ -11,9 +18,27 @@ napi_status napi_get_value(napi_env env, napi_value value,
   return napi_ok;
 }
 
+// Wraps an icon handle, taking ownership unless it's shared.
+static napi_status new_handle_icon(napi_env env, HICON icon, bool shared,
+                                   icon_size_t size, napi_value* result) {
+  auto env_data = get_env_data(env);
+  NAPI_RETURN_IF_NOT_OK(
+      IconObject::new_instance(env, env_data->icon_constructor, result));
+  IconObject* wrapped = nullptr;
+  NAPI_RETURN_IF_NOT_OK(IconObject::try_unwrap(env, *result, &wrapped));
+  wrapped->icon = icon;
+  wrapped->shared = shared;
+  wrapped->width = size.width;
+  wrapped->height = size.height;
+  if (!shared) {
+    NAPI_RETURN_IF_NOT_OK(wrapped->materialize(env));
+    env_data->trim_icons();
+  }
+  return napi_ok;
+}
+
 napi_status load_icon(napi_env env, HINSTANCE hinstance, LPCWSTR path,
                       icon_size_t size, DWORD flags, napi_value* result) {
-  auto env_data = get_env_data(env);
   auto shared = (flags & LR_SHARED) != 0;
 
   auto icon = (HICON)LoadImageW(hinstance, path, IMAGE_ICON, size.width,
@@ -25,15 +50,7 @@ napi_status load_icon(napi_env env, HINSTANCE hinstance, LPCWSTR path,
 
   Unique<HICON, DestroyIcon> owned_icon = shared ? icon : nullptr;
 
-  NAPI_RETURN_IF_NOT_OK(
-      IconObject::new_instance(env, env_data->icon_constructor, result));
-  IconObject* wrapped = nullptr;
-  NAPI_RETURN_IF_NOT_OK(IconObject::try_unwrap(env, *result, &wrapped));
-  wrapped->icon = icon;
-  wrapped->shared = shared;
-  wrapped->width = size.width;
-  wrapped->height = size.height;
-  return napi_ok;
+  return new_handle_icon(env, icon, shared, size, result);
 }
 
 napi_value export_Icon_loadBuiltin(napi_env env, napi_callback_info info) {
@@ -132,6 +149,568 @@ napi_value export_Icon_loadFile(napi_env env, napi_callback_info info) {
   return result;
 }
 
+// Loads the Windows stock icon closest to a freedesktop.org icon name, so
+// cross-platform code can use one set of names.
+napi_value export_Icon_loadNamed(napi_env env, napi_callback_info info) {
+  std::string name;
+  icon_size_t size;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &name, &size));
+
+  HICON icon;
+  if (auto error = load_stock_icon(name, size.width, &icon)) {
+    napi_throw_win32_error(env, error.syscall, error.code);
+    return nullptr;
+  }
+  if (!icon) {
+    napi_throw_error(env, nullptr,
+                     ("No icon matches \""s + name + "\".").c_str());
+    return nullptr;
+  }
+
+  napi_value result;
+  NAPI_RETURN_NULL_IF_NOT_OK(new_handle_icon(env, icon, false, size, &result));
+  return result;
+}
+
+// Creates an Icon that will create its handle from the pixels on first use.
+static napi_status new_bitmap_icon(napi_env env, IconBitmapView view,
+                                   napi_value* result) {
+  auto env_data = get_env_data(env);
+  NAPI_RETURN_IF_NOT_OK(
+      IconObject::new_instance(env, env_data->icon_constructor, result));
+  IconObject* wrapped = nullptr;
+  NAPI_RETURN_IF_NOT_OK(IconObject::try_unwrap(env, *result, &wrapped));
+  wrapped->width = view.width;
+  wrapped->height = view.height;
+  wrapped->source = std::move(view);
+  return napi_ok;
+}
+
+// The image in a .ico file best matching the size: the exact size with the
+// most colors, or else the smallest larger image, or else the largest.
+struct ico_image {
+  const BYTE* data = nullptr;
+  DWORD size = 0;
+};
+
+static bool find_ico_image(const BYTE* data, size_t size, icon_size_t target,
+                           ico_image* result) {
+  auto read16 = [&](size_t offset) {
+    return (uint16_t)(data[offset] | data[offset + 1] << 8);
+  };
+  auto read32 = [&](size_t offset) {
+    return (uint32_t)read16(offset) | (uint32_t)read16(offset + 2) << 16;
+  };
+
+  // ICONDIR: reserved = 0, type = 1 (icon), count.
+  if (size < 6 || read16(0) != 0 || read16(2) != 1) {
+    return false;
+  }
+  auto count = read16(4);
+  if (size < 6 + (size_t)count * 16) {
+    return false;
+  }
+
+  int best_score = 0;
+  for (uint16_t index = 0; index != count; index++) {
+    // ICONDIRENTRY: width, height (0 means 256), colors, reserved, planes,
+    // bit count, bytes, offset.
+    auto entry = 6 + (size_t)index * 16;
+    int width = data[entry] ? data[entry] : 256;
+    int height = data[entry + 1] ? data[entry + 1] : 256;
+    auto bit_count = read16(entry + 6);
+    auto bytes = read32(entry + 8);
+    auto offset = read32(entry + 12);
+    if (offset > size || bytes > size - offset) {
+      continue;
+    }
+
+    int score;
+    if (width == target.width && height == target.height) {
+      score = 0x20000 + bit_count;
+    } else if (width >= target.width && height >= target.height) {
+      score = 0x10000 - width;
+    } else {
+      score = width;
+    }
+    if (score > best_score) {
+      best_score = score;
+      *result = {data + offset, bytes};
+    }
+  }
+  return best_score != 0;
+}
+
+// Loads an icon from a .ico file or any image format WIC supports, in memory,
+// e.g. read from an archive.
+napi_value export_Icon_loadBuffer(napi_env env, napi_callback_info info) {
+  napi_buffer_info buffer;
+  icon_size_t size;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_required_args(env, info, &buffer, &size));
+
+  napi_value result;
+  ico_image image;
+  if (find_ico_image((const BYTE*)buffer.data, buffer.size, size, &image)) {
+    // Handles both bitmap and PNG images, scaling if needed.
+    auto icon = CreateIconFromResourceEx(
+        (BYTE*)image.data, image.size, TRUE, 0x00030000, size.width,
+        size.height, LR_DEFAULTCOLOR);
+    if (!icon) {
+      napi_throw_win32_error(env, "CreateIconFromResourceEx");
+      return nullptr;
+    }
+    NAPI_RETURN_NULL_IF_NOT_OK(
+        new_handle_icon(env, icon, false, size, &result));
+    return result;
+  }
+
+  auto bitmap = std::make_shared<IconBitmap>();
+  if (auto error = decode_image_memory(buffer.data, buffer.size, bitmap.get(),
+                                       size.width, size.height)) {
+    napi_throw_win32_error(env, error.syscall, error.code);
+    return nullptr;
+  }
+  NAPI_RETURN_NULL_IF_NOT_OK(new_bitmap_icon(
+      env, {bitmap, 0, 0, bitmap->width, bitmap->height}, &result));
+  return result;
+}
+
+struct image_source {
+  std::optional<std::wstring> path;
+  napi_buffer_info buffer = {};
+};
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           image_source* result) {
+  bool is_buffer;
+  NAPI_RETURN_IF_NOT_OK(napi_is_buffer(env, value, &is_buffer));
+  if (is_buffer) {
+    return napi_get_value(env, value, &result->buffer);
+  }
+  return napi_get_value(env, value, &result->path.emplace());
+}
+
+struct atlas_options {
+  int32_t tile_width = 0;
+  int32_t tile_height = 0;
+  std::optional<uint32_t> count;
+};
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           atlas_options* result) {
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "tileWidth", &result->tile_width));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "tileHeight", &result->tile_height));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "count", &result->count));
+  return napi_ok;
+}
+
+// Decodes the image once, then creates an Icon for each tile, left to right
+// then top to bottom. The tiles share the decoded pixels until their handle is
+// created on first use, so unused states are cheap.
+napi_value export_Icon_loadAtlas(napi_env env, napi_callback_info info) {
+  image_source source;
+  atlas_options options;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_required_args(env, info, &source, &options));
+
+  if (options.tile_width <= 0 || options.tile_height <= 0) {
+    napi_throw_range_error(env, nullptr,
+                           "tileWidth and tileHeight must be positive.");
+    return nullptr;
+  }
+
+  auto bitmap = std::make_shared<IconBitmap>();
+  if (auto error = source.path ? decode_image_file(source.path->c_str(),
+                                                   bitmap.get())
+                               : decode_image_memory(source.buffer.data,
+                                                     source.buffer.size,
+                                                     bitmap.get())) {
+    napi_throw_win32_error(env, error.syscall, error.code);
+    return nullptr;
+  }
+
+  auto columns = (uint32_t)(bitmap->width / options.tile_width);
+  auto rows = (uint32_t)(bitmap->height / options.tile_height);
+  auto count = options.count.value_or(columns * rows);
+  if (count > columns * rows) {
+    napi_throw_range_error(
+        env, nullptr,
+        ("count is "s + std::to_string(count) + " but the image only has "s +
+         std::to_string(columns * rows) + " tiles."s)
+            .c_str());
+    return nullptr;
+  }
+
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_array_with_length(env, count, &result));
+
+  for (uint32_t index = 0; index != count; index++) {
+    napi_value item;
+    NAPI_RETURN_NULL_IF_NOT_OK(new_bitmap_icon(
+        env,
+        {
+            bitmap,
+            (int32_t)(index % columns) * options.tile_width,
+            (int32_t)(index / columns) * options.tile_height,
+            options.tile_width,
+            options.tile_height,
+        },
+        &item));
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(env,
+                                     napi_set_element(env, result, index, item));
+  }
+
+  return result;
+}
+
+struct svg_source {
+  std::string text;
+  napi_buffer_info buffer = {};
+
+  std::string_view view() const {
+    return buffer.data ? std::string_view{(const char*)buffer.data, buffer.size}
+                       : std::string_view{text};
+  }
+};
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           svg_source* result) {
+  bool is_buffer;
+  NAPI_RETURN_IF_NOT_OK(napi_is_buffer(env, value, &is_buffer));
+  if (is_buffer) {
+    return napi_get_value(env, value, &result->buffer);
+  }
+  return napi_get_value(env, value, &result->text);
+}
+
+// Rasterized documents by content hash and size, most recently used first,
+// so repeated loads, e.g. on DPI changes, don't rasterize again.
+struct svg_cache_entry {
+  uint64_t hash;
+  int32_t width;
+  int32_t height;
+  std::shared_ptr<const IconBitmap> bitmap;
+};
+
+constexpr size_t svg_cache_capacity = 64;
+static std::mutex svg_cache_mutex;
+static std::list<svg_cache_entry> svg_cache;
+
+// FNV-1a
+static uint64_t hash_document(std::string_view document) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (auto c : document) {
+    hash = (hash ^ (uint8_t)c) * 0x100000001b3;
+  }
+  return hash;
+}
+
+static std::shared_ptr<const IconBitmap> find_svg_cache(uint64_t hash,
+                                                        icon_size_t size) {
+  std::lock_guard lock{svg_cache_mutex};
+  for (auto it = svg_cache.begin(); it != svg_cache.end(); ++it) {
+    if (it->hash == hash && it->width == size.width &&
+        it->height == size.height) {
+      svg_cache.splice(svg_cache.begin(), svg_cache, it);
+      return it->bitmap;
+    }
+  }
+  return nullptr;
+}
+
+static void add_svg_cache(uint64_t hash, icon_size_t size,
+                          std::shared_ptr<const IconBitmap> bitmap) {
+  std::lock_guard lock{svg_cache_mutex};
+  svg_cache.push_front({hash, size.width, size.height, std::move(bitmap)});
+  if (svg_cache.size() > svg_cache_capacity) {
+    svg_cache.pop_back();
+  }
+}
+
+napi_value export_Icon_fromSVG(napi_env env, napi_callback_info info) {
+  svg_source source;
+  icon_size_t size;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &source, &size));
+
+  auto document = source.view();
+  auto hash = hash_document(document);
+  auto bitmap = find_svg_cache(hash, size);
+  if (!bitmap) {
+    auto new_bitmap = std::make_shared<IconBitmap>();
+    std::string error;
+    if (!rasterize_svg(document, size.width, size.height, new_bitmap.get(),
+                       &error)) {
+      napi_throw_error(env, nullptr, ("Invalid SVG: "s + error).c_str());
+      return nullptr;
+    }
+    bitmap = new_bitmap;
+    add_svg_cache(hash, size, bitmap);
+  }
+
+  napi_value result;
+  NAPI_RETURN_NULL_IF_NOT_OK(new_bitmap_icon(
+      env, {bitmap, 0, 0, bitmap->width, bitmap->height}, &result));
+  return result;
+}
+
+static napi_status new_surface_icon(napi_env env,
+                                    std::shared_ptr<IconSurface> surface,
+                                    napi_value* result) {
+  auto env_data = get_env_data(env);
+  NAPI_RETURN_IF_NOT_OK(
+      IconObject::new_instance(env, env_data->icon_constructor, result));
+  IconObject* wrapped = nullptr;
+  NAPI_RETURN_IF_NOT_OK(IconObject::try_unwrap(env, *result, &wrapped));
+  wrapped->width = surface->width();
+  wrapped->height = surface->height();
+  wrapped->surface = std::move(surface);
+  return napi_ok;
+}
+
+static std::shared_ptr<IconSurface> create_surface(napi_env env,
+                                                   icon_size_t size) {
+  if (size.width <= 0 || size.height <= 0) {
+    napi_throw_range_error(env, nullptr, "width and height must be positive.");
+    return nullptr;
+  }
+
+  icon_bitmap_error error;
+  auto surface = create_icon_surface(size.width, size.height, &error);
+  if (!surface) {
+    napi_throw_win32_error(env, error.syscall, error.code);
+  }
+  return surface;
+}
+
+// Returns an Icon displaying a new surface, see IconSurface.
+napi_value export_Icon_createSurfaceIcon(napi_env env,
+                                         napi_callback_info info) {
+  icon_size_t size;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &size));
+
+  auto surface = create_surface(env, size);
+  if (!surface) {
+    return nullptr;
+  }
+
+  napi_value result;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      new_surface_icon(env, std::move(surface), &result));
+  return result;
+}
+
+// Like loadFile(), but the Icon reloads whenever the file changes, updating
+// any NotifyIcon showing it.
+napi_value export_Icon_watch(napi_env env, napi_callback_info info) {
+  std::wstring path;
+  icon_size_t size;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &path, &size));
+
+  auto surface = create_surface(env, size);
+  if (!surface) {
+    return nullptr;
+  }
+
+  if (auto error = watch_icon_file(path, surface)) {
+    release_icon_surface(surface->id);
+    napi_throw_win32_error(env, error.syscall, error.code);
+    return nullptr;
+  }
+
+  napi_value result;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      new_surface_icon(env, std::move(surface), &result));
+  return result;
+}
+
+struct surface_pixels {
+  const uint32_t* data = nullptr;
+  size_t length = 0;
+};
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           surface_pixels* result) {
+  bool is_typedarray;
+  NAPI_RETURN_IF_NOT_OK(napi_is_typedarray(env, value, &is_typedarray));
+  napi_typedarray_type type = napi_int8_array;
+  void* data = nullptr;
+  if (is_typedarray) {
+    NAPI_RETURN_IF_NOT_OK(napi_get_typedarray_info(
+        env, value, &type, &result->length, &data, nullptr, nullptr));
+  }
+  if (type != napi_uint32_array) {
+    napi_throw_type_error(env, nullptr, "Expected Uint32Array");
+    return napi_pending_exception;
+  }
+  result->data = static_cast<const uint32_t*>(data);
+  return napi_ok;
+}
+
+struct surface_rect {
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+};
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           surface_rect* result) {
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "x", &result->x));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "y", &result->y));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "width", &result->width));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "height", &result->height));
+  return napi_ok;
+}
+
+// Can be called from any environment, e.g. a worker, as surfaces are
+// process-wide. Only the dirty rectangle (default all) is read.
+napi_value export_Icon_commitSurface(napi_env env, napi_callback_info info) {
+  int32_t id;
+  surface_pixels pixels;
+  std::optional<surface_rect> rect;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_args(env, info, 2, &id, &pixels, &rect));
+
+  auto surface = find_icon_surface(id);
+  if (!surface) {
+    napi_throw_error(env, nullptr, "Surface has been released.");
+    return nullptr;
+  }
+
+  if (pixels.length != (size_t)surface->width() * surface->height()) {
+    napi_throw_range_error(env, nullptr,
+                           "pixels must have width * height elements.");
+    return nullptr;
+  }
+
+  RECT dirty = {0, 0, surface->width(), surface->height()};
+  if (rect) {
+    RECT requested = {rect->x, rect->y, rect->x + rect->width,
+                      rect->y + rect->height};
+    if (!IntersectRect(&dirty, &dirty, &requested)) {
+      return nullptr;
+    }
+  }
+
+  surface->commit(pixels.data, dirty);
+  return nullptr;
+}
+
+napi_value export_Icon_surfaceId(napi_env env, napi_callback_info info) {
+  IconObject* icon_object = nullptr;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &icon_object));
+  if (!icon_object->surface) {
+    return nullptr;
+  }
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create(env, icon_object->surface->id, &result));
+  return result;
+}
+
+napi_status napi_get_value(napi_env env, napi_value value,
+                           icon_variant_params* result) {
+  std::optional<bool> grayscale;
+  std::optional<uint32_t> tint;
+  std::optional<double> opacity;
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "grayscale", &grayscale));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "tint", &tint));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "opacity", &opacity));
+
+  result->grayscale = grayscale.value_or(false);
+  result->tint = tint.value_or(0xffffff) & 0xffffff;
+  result->opacity =
+      (uint8_t)(std::clamp(opacity.value_or(1.0), 0.0, 1.0) * 255 + 0.5);
+  return napi_ok;
+}
+
+napi_value export_Icon_variant(napi_env env, napi_callback_info info) {
+  IconObject* this_object;
+  icon_variant_params params;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_object, nullptr, 1, &params));
+
+  napi_value result;
+  for (auto& [key, ref] : this_object->variants) {
+    if (key == params) {
+      NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, ref.get(&result));
+      return result;
+    }
+  }
+
+  IconBitmapView view;
+  if (this_object->source) {
+    view = this_object->source.value();
+  } else {
+    NAPI_RETURN_NULL_IF_NOT_OK(this_object->materialize(env));
+    auto bitmap = std::make_shared<IconBitmap>();
+    if (auto error = snapshot_icon(this_object->icon, bitmap.get())) {
+      napi_throw_win32_error(env, error.syscall, error.code);
+      return nullptr;
+    }
+    view = {bitmap, 0, 0, bitmap->width, bitmap->height};
+  }
+
+  auto bitmap = std::make_shared<IconBitmap>();
+  apply_icon_variant(view, params, bitmap.get());
+
+  NAPI_RETURN_NULL_IF_NOT_OK(new_bitmap_icon(
+      env, {bitmap, 0, 0, bitmap->width, bitmap->height}, &result));
+
+  // Surfaces change, so their variants are only snapshots.
+  if (!this_object->surface) {
+    NapiRef ref;
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, ref.create(env, result));
+    this_object->variants.emplace_back(params, std::move(ref));
+  }
+  return result;
+}
+
+napi_value export_Icon_get_handleBudget(napi_env env,
+                                        napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env,
+      napi_create(env, (uint32_t)env_data->icon_handle_budget, &result));
+  return result;
+}
+
+napi_value export_Icon_set_handleBudget(napi_env env,
+                                        napi_callback_info info) {
+  uint32_t budget;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &budget));
+
+  auto env_data = get_env_data(env);
+  env_data->icon_handle_budget = budget;
+  env_data->trim_icons();
+  return nullptr;
+}
+
+napi_value export_Icon_get_handleStats(napi_env env,
+                                       napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env,
+      napi_create_object(
+          env, &result,
+          {
+              {"resident", (uint32_t)env_data->resident_icons.size()},
+              {"evicted", (double)env_data->evicted_icon_count},
+              {"rematerialized", (double)env_data->rematerialized_icon_count},
+          }));
+  return result;
+}
+
 napi_property_descriptor system_metric_property(
     const char* utf8name, int metric,
     napi_property_attributes attributes = napi_enumerable) {
@@ -166,11 +745,82 @@ napi_property_descriptor member_getter_property(
 }
 
 IconObject::~IconObject() {
+  if (surface) {
+    release_icon_surface(surface->id);
+  }
+  if (resident) {
+    if (auto env_data = get_env_data(env_)) {
+      env_data->forget_icon(this);
+    }
+  }
   if (!shared) {
     DestroyIcon(icon);
   }
 }
 
+napi_status IconObject::materialize(napi_env env) {
+  if (shared) {
+    return napi_ok;
+  }
+
+  // Could have been committed since the last use from any thread, so always
+  // take a new snapshot.
+  if (surface) {
+    HICON new_icon;
+    if (auto error = surface->create_icon(&new_icon, &surface_version)) {
+      napi_throw_win32_error(env, error.syscall, error.code);
+      return napi_pending_exception;
+    }
+    DestroyIcon(icon);
+    icon = new_icon;
+    return napi_ok;
+  }
+
+  auto env_data = get_env_data(env);
+
+  if (!icon && source) {
+    if (auto error = create_icon(source.value(), &icon)) {
+      napi_throw_win32_error(env, error.syscall, error.code);
+      return napi_pending_exception;
+    }
+    if (evicted) {
+      evicted = false;
+      env_data->rematerialized_icon_count++;
+    }
+    // Without a budget it won't be evicted, so don't keep the (possibly
+    // shared) pixels alive any longer than needed.
+    if (!env_data->icon_handle_budget) {
+      source.reset();
+    }
+  }
+
+  if (icon) {
+    env_ = env;
+    env_data->touch_icon(this);
+  }
+  return napi_ok;
+}
+
+bool IconObject::evict() {
+  if (shared || !icon || pins) {
+    return false;
+  }
+
+  if (!source) {
+    auto bitmap = std::make_shared<IconBitmap>();
+    if (snapshot_icon(icon, bitmap.get())) {
+      return false;
+    }
+    source.emplace(
+        IconBitmapView{bitmap, 0, 0, bitmap->width, bitmap->height});
+  }
+
+  DestroyIcon(icon);
+  icon = nullptr;
+  evicted = true;
+  return true;
+}
+
 napi_status IconObject::define_class(EnvData* env_data,
                                      napi_value* constructor_value) {
   auto env = env_data->env;
@@ -198,8 +848,27 @@ napi_status IconObject::define_class(EnvData* env_data,
           napi_method_property("loadBuiltin", export_Icon_loadBuiltin,
                                napi_static),
           napi_method_property("loadFile", export_Icon_loadFile, napi_static),
+          napi_method_property("loadNamed", export_Icon_loadNamed,
+                               napi_static),
+          napi_method_property("watch", export_Icon_watch, napi_static),
+          napi_method_property("loadBuffer", export_Icon_loadBuffer,
+                               napi_static),
+          napi_method_property("loadAtlas", export_Icon_loadAtlas,
+                               napi_static),
+          napi_method_property("fromSVG", export_Icon_fromSVG, napi_static),
+          napi_getter_setter_property(
+              "handleBudget", export_Icon_get_handleBudget,
+              export_Icon_set_handleBudget, napi_static),
+          napi_getter_property("handleStats", export_Icon_get_handleStats,
+                               napi_static),
+          napi_method_property("createSurfaceIcon",
+                               export_Icon_createSurfaceIcon, napi_static),
+          napi_method_property("commitSurface", export_Icon_commitSurface,
+                               napi_static),
 
           member_getter_property<&IconObject::width>("width"),
           member_getter_property<&IconObject::height>("height"),
+          napi_getter_property("surfaceId", export_Icon_surfaceId),
+          napi_method_property("variant", export_Icon_variant),
       });
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "data.hh"
+#include "icon-bitmap.hh"
+#include "icon-surface.hh"
+#include "icon-variant.hh"
 #include "napi/wrap.hh"
 
 struct icon_size_t {
@@ -12,9 +15,35 @@ struct IconObject : NapiWrapped<IconObject> {
   int32_t width = 0;
   int32_t height = 0;
   bool shared = false;
+  // Pixels to create `icon` from on next use, e.g. an atlas tile, or a
+  // snapshot taken when it was evicted.
+  std::optional<IconBitmapView> source;
+  // Pixels that can be committed at any time, and the version `icon` was last
+  // created from.
+  std::shared_ptr<IconSurface> surface;
+  uint64_t surface_version = 0;
+
+  // Owned handle tracking for EnvData::trim_icons().
+  napi_env env_ = nullptr;
+  bool resident = false;
+  std::list<IconObject*>::iterator resident_it;
+  // Number of notify icons currently using this icon, which must keep their
+  // handles.
+  int32_t pins = 0;
+  bool evicted = false;
+
+  // Icons derived by variant(), released along with this icon.
+  std::vector<std::pair<icon_variant_params, NapiRef>> variants;
 
   ~IconObject();
 
+  // Ensures `icon` has been created, throwing if that fails, and marks it as
+  // recently used.
+  napi_status materialize(napi_env env);
+  // Destroys `icon`, keeping only what's needed to recreate it. Returns false
+  // if it can't be recreated, e.g. a shared icon.
+  bool evict();
+
   static napi_status define_class(EnvData* env_data,
                                   napi_value* constructor_value);
 };
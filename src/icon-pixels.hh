@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Decoded 32bpp BGRA pixels with straight (not premultiplied) alpha, top-down
+// rows, which is what CreateIconIndirect() wants for a 32bpp color bitmap.
+// Kept apart from icon-bitmap.hh, as producing them doesn't need Windows.
+struct IconBitmap {
+  int32_t width = 0;
+  int32_t height = 0;
+  std::vector<uint32_t> pixels;
+
+  uint32_t* row(int32_t y) { return pixels.data() + (size_t)y * width; }
+  const uint32_t* row(int32_t y) const {
+    return pixels.data() + (size_t)y * width;
+  }
+};
+
+// A rectangle of a (possibly shared) decoded bitmap, e.g. a single tile of an
+// atlas. Holds the bitmap alive until the view is dropped.
+struct IconBitmapView {
+  std::shared_ptr<const IconBitmap> bitmap;
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+};
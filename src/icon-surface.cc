@@ -0,0 +1,130 @@
+#include "icon-surface.hh"
+
+#include <unordered_map>
+
+static std::mutex surfaces_mutex;
+static int32_t last_surface_id = 0;
+static std::unordered_map<int32_t, std::shared_ptr<IconSurface>> surfaces;
+
+std::shared_ptr<IconSurface> create_icon_surface(int32_t width, int32_t height,
+                                                 icon_bitmap_error* error) {
+  std::lock_guard lock{surfaces_mutex};
+  auto surface = std::make_shared<IconSurface>(++last_surface_id);
+  if ((*error = surface->canvas.create(width, height))) {
+    return nullptr;
+  }
+  std::fill_n(surface->canvas.bits, (size_t)width * height, 0);
+  surfaces.insert({surface->id, surface});
+  return surface;
+}
+
+std::shared_ptr<IconSurface> find_icon_surface(int32_t id) {
+  std::lock_guard lock{surfaces_mutex};
+  if (auto it = surfaces.find(id); it != surfaces.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
+void release_icon_surface(int32_t id) {
+  std::lock_guard lock{surfaces_mutex};
+  surfaces.erase(id);
+}
+
+void republish_icon_surfaces(HWND hwnd) {
+  std::vector<std::shared_ptr<IconSurface>> all;
+  {
+    std::lock_guard lock{surfaces_mutex};
+    for (auto& [id, surface] : surfaces) {
+      all.push_back(surface);
+    }
+  }
+  for (auto& surface : all) {
+    surface->republish(hwnd);
+  }
+}
+
+static bool same_display(const notify_icon_id& a, const notify_icon_id& b) {
+  return a.callback_hwnd == b.callback_hwnd && a.callback_id == b.callback_id;
+}
+
+void IconSurface::commit(const uint32_t* pixels, const RECT& dirty) {
+  std::lock_guard lock{mutex};
+  auto row_width = (size_t)(dirty.right - dirty.left);
+  for (auto y = dirty.top; y < dirty.bottom; y++) {
+    auto src = pixels + (size_t)y * canvas.width + dirty.left;
+    std::copy(src, src + row_width, canvas.row(y) + dirty.left);
+  }
+  version++;
+
+  for (auto& display : displays) {
+    if (!display.posted &&
+        PostMessageW(display.id.callback_hwnd, WM_USER_SURFACE_COMMIT,
+                     (WPARAM)id, 0)) {
+      display.posted = true;
+    }
+  }
+}
+
+icon_bitmap_error IconSurface::create_icon(HICON* result,
+                                           uint64_t* result_version) {
+  std::lock_guard lock{mutex};
+  *result_version = version;
+  return canvas.create_icon(result);
+}
+
+void IconSurface::add_display(const notify_icon_id& display_id,
+                              uint64_t shown_version) {
+  std::lock_guard lock{mutex};
+  auto& display = displays.emplace_back();
+  display.id = display_id;
+  display.shown_version = shown_version;
+  // Missed a commit since the icon was created.
+  display.posted = shown_version != version &&
+                   PostMessageW(display_id.callback_hwnd,
+                                WM_USER_SURFACE_COMMIT, (WPARAM)id, 0);
+}
+
+void IconSurface::remove_display(const notify_icon_id& display_id) {
+  std::lock_guard lock{mutex};
+  for (auto it = displays.begin(); it != displays.end(); ++it) {
+    if (same_display(it->id, display_id)) {
+      displays.erase(it);
+      return;
+    }
+  }
+}
+
+void IconSurface::republish(HWND hwnd) {
+  {
+    std::lock_guard lock{mutex};
+    for (auto& display : displays) {
+      if (display.id.callback_hwnd == hwnd) {
+        display.shown_version = ~version;
+      }
+    }
+  }
+  publish(hwnd);
+}
+
+void IconSurface::publish(HWND hwnd) {
+  std::lock_guard lock{mutex};
+  Unique<HICON, DestroyIcon> icon;
+  for (auto& display : displays) {
+    if (display.id.callback_hwnd != hwnd) {
+      continue;
+    }
+    display.posted = false;
+    if (display.shown_version == version) {
+      continue;
+    }
+    // Shared by every display on this thread, the shell takes a copy.
+    if (!icon && canvas.create_icon(&icon.value)) {
+      return;
+    }
+    notify_icon_options options;
+    options.icon = icon;
+    modify_notify_icon(display.id, options);
+    display.shown_version = version;
+  }
+}
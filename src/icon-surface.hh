@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "icon-bitmap.hh"
+#include "notify-icon.hh"
+
+// Posted to a notify icon message window with the surface id as wParam when a
+// surface it displays has been committed.
+constexpr auto WM_USER_SURFACE_COMMIT = WM_USER + 3;
+
+// Pixels that can be committed from any thread and are then published to every
+// notify icon displaying them, without going through the JS thread that owns
+// the icons. Registered process-wide by id, as the committing thread may be
+// in a different environment, e.g. a worker.
+struct IconSurface {
+  const int32_t id;
+
+  explicit IconSurface(int32_t id) : id{id} {}
+
+  // Copies the rectangle of `pixels` (the full surface, with rows of `width`
+  // straight alpha BGRA) that changed, and posts to each display that isn't
+  // already waiting to publish.
+  void commit(const uint32_t* pixels, const RECT& dirty);
+
+  // Creates an owned icon handle from the current pixels, and the version it
+  // was created from.
+  icon_bitmap_error create_icon(HICON* result, uint64_t* result_version);
+
+  // Start and stop publishing commits to a notify icon, which is already
+  // showing the version given.
+  void add_display(const notify_icon_id& display_id, uint64_t shown_version);
+  void remove_display(const notify_icon_id& display_id);
+
+  // Called on the message thread of `hwnd` in response to
+  // WM_USER_SURFACE_COMMIT, updates its notify icons that are out of date.
+  void publish(HWND hwnd);
+  // As publish(), but updating every notify icon on `hwnd`, for when they
+  // may have been restored showing an older version.
+  void republish(HWND hwnd);
+
+  int32_t width() const { return canvas.width; }
+  int32_t height() const { return canvas.height; }
+
+ private:
+  friend std::shared_ptr<IconSurface> create_icon_surface(
+      int32_t width, int32_t height, icon_bitmap_error* error);
+
+  struct display {
+    notify_icon_id id;
+    uint64_t shown_version;
+    bool posted;
+  };
+
+  std::mutex mutex;
+  IconCanvas canvas;
+  uint64_t version = 0;
+  std::vector<display> displays;
+};
+
+std::shared_ptr<IconSurface> create_icon_surface(int32_t width, int32_t height,
+                                                 icon_bitmap_error* error);
+// Returns nullptr if the surface has been released.
+std::shared_ptr<IconSurface> find_icon_surface(int32_t id);
+void release_icon_surface(int32_t id);
+// Calls republish() on every surface, on the message thread of `hwnd`.
+void republish_icon_surfaces(HWND hwnd);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "icon-bitmap.hh"
+
+// Per-pixel adjustments to derive e.g. disabled or themed states of an icon.
+struct icon_variant_params {
+  bool grayscale = false;
+  // 0xRRGGBB multiplied with each pixel, after grayscale if both are set.
+  uint32_t tint = 0xffffff;
+  // Multiplied with alpha, 0 to 255.
+  uint8_t opacity = 255;
+
+  bool operator==(const icon_variant_params& other) const {
+    return grayscale == other.grayscale && tint == other.tint &&
+           opacity == other.opacity;
+  }
+};
+
+// Writes the adjusted pixels of `source` to `result`, which is resized to
+// match.
+void apply_icon_variant(const IconBitmapView& source,
+                        const icon_variant_params& params, IconBitmap* result);
@@ -0,0 +1,176 @@
+#include "icon-watcher.hh"
+
+#include <algorithm>
+#include <list>
+#include <thread>
+
+// Editors often write files in several steps, wait for them to settle before
+// reloading.
+constexpr ULONGLONG reload_delay_ms = 100;
+// How often to check for released surfaces when nothing changes.
+constexpr DWORD cleanup_interval_ms = 10000;
+
+using ChangeHandle = Unique<HANDLE, FindCloseChangeNotification>;
+
+struct watched_file {
+  std::wstring path;
+  std::weak_ptr<IconSurface> surface;
+  ChangeHandle change;
+  FILETIME last_write = {};
+  // Tick count to reload at, or 0.
+  ULONGLONG reload_at = 0;
+};
+
+static std::mutex watches_mutex;
+static std::list<watched_file> watches;
+static HANDLE wake_event = nullptr;
+
+static icon_bitmap_error load_icon_file(const std::wstring& path,
+                                        int32_t width, int32_t height,
+                                        IconBitmap* result) {
+  Unique<HICON, DestroyIcon> icon = (HICON)LoadImageW(
+      nullptr, path.c_str(), IMAGE_ICON, width, height, LR_LOADFROMFILE);
+  if (!icon) {
+    return {"LoadImageW", (HRESULT)GetLastError()};
+  }
+  if (auto error = snapshot_icon(icon, result)) {
+    return error;
+  }
+  if (result->width != width || result->height != height) {
+    return {"LoadImageW", ERROR_INVALID_DATA};
+  }
+  return {};
+}
+
+static icon_bitmap_error reload(const std::wstring& path,
+                                IconSurface* surface) {
+  IconBitmap bitmap;
+  if (auto error = load_icon_file(path, surface->width(), surface->height(),
+                                  &bitmap)) {
+    return error;
+  }
+  surface->commit(bitmap.pixels.data(),
+                  {0, 0, surface->width(), surface->height()});
+  return {};
+}
+
+static bool get_last_write(const std::wstring& path, FILETIME* result) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+    return false;
+  }
+  *result = data.ftLastWriteTime;
+  return true;
+}
+
+// Runs for the rest of the process once started, as joining it while the
+// module is being unloaded could deadlock.
+static void watch_thread_proc() {
+  while (true) {
+    std::vector<HANDLE> handles{wake_event};
+    std::vector<watched_file*> targets;
+    DWORD timeout = cleanup_interval_ms;
+    {
+      std::lock_guard lock{watches_mutex};
+      auto now = GetTickCount64();
+      for (auto it = watches.begin(); it != watches.end();) {
+        if (it->surface.expired()) {
+          it = watches.erase(it);
+          continue;
+        }
+        handles.push_back(it->change);
+        targets.push_back(&*it);
+        if (it->reload_at) {
+          timeout = std::min(
+              timeout, (DWORD)(it->reload_at > now ? it->reload_at - now : 0));
+        }
+        ++it;
+      }
+    }
+
+    auto wait = WaitForMultipleObjects((DWORD)handles.size(), handles.data(),
+                                       FALSE, timeout);
+
+    std::vector<std::pair<std::wstring, std::shared_ptr<IconSurface>>> reloads;
+    {
+      std::lock_guard lock{watches_mutex};
+      auto now = GetTickCount64();
+      if (wait > WAIT_OBJECT_0 && wait < WAIT_OBJECT_0 + handles.size()) {
+        auto target = targets[wait - WAIT_OBJECT_0 - 1];
+        FindNextChangeNotification(target->change);
+        // Restart the delay on every change.
+        target->reload_at = now + reload_delay_ms;
+      }
+
+      for (auto target : targets) {
+        if (!target->reload_at || target->reload_at > now) {
+          continue;
+        }
+        target->reload_at = 0;
+
+        // The notification is for the whole directory.
+        FILETIME last_write;
+        if (!get_last_write(target->path, &last_write) ||
+            !CompareFileTime(&last_write, &target->last_write)) {
+          continue;
+        }
+        if (auto surface = target->surface.lock()) {
+          target->last_write = last_write;
+          reloads.emplace_back(target->path, std::move(surface));
+        }
+      }
+    }
+
+    // Decode outside the lock. On failure, e.g. a partially written file, the
+    // previous icon is kept until the next change.
+    for (auto& [path, surface] : reloads) {
+      reload(path, surface.get());
+    }
+  }
+}
+
+icon_bitmap_error watch_icon_file(const std::wstring& path,
+                                  std::shared_ptr<IconSurface> surface) {
+  std::wstring full_path(MAX_PATH, L'\0');
+  LPWSTR file_part = nullptr;
+  auto length = GetFullPathNameW(path.c_str(), (DWORD)full_path.size(),
+                                 full_path.data(), &file_part);
+  if (!length || length >= full_path.size() || !file_part) {
+    return {"GetFullPathNameW", (HRESULT)GetLastError()};
+  }
+  auto directory = full_path.substr(0, file_part - full_path.data());
+  full_path.resize(length);
+
+  watched_file watch;
+  watch.path = full_path;
+  watch.surface = surface;
+  get_last_write(full_path, &watch.last_write);
+
+  if (auto error = reload(full_path, surface.get())) {
+    return error;
+  }
+
+  auto change = FindFirstChangeNotificationW(
+      directory.c_str(), FALSE,
+      FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+  if (change == INVALID_HANDLE_VALUE) {
+    return {"FindFirstChangeNotificationW", (HRESULT)GetLastError()};
+  }
+  watch.change = change;
+
+  std::lock_guard lock{watches_mutex};
+  // One handle is the wake event.
+  if (watches.size() + 1 >= MAXIMUM_WAIT_OBJECTS) {
+    return {"WaitForMultipleObjects", ERROR_TOO_MANY_OPEN_FILES};
+  }
+  if (!wake_event) {
+    wake_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (!wake_event) {
+      return {"CreateEventW", (HRESULT)GetLastError()};
+    }
+    std::thread(watch_thread_proc).detach();
+  }
+  watches.push_back(std::move(watch));
+  SetEvent(wake_event);
+  return {};
+}
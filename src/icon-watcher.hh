@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include "icon-surface.hh"
+
+// Loads the icon file at `path` into `surface` at its size, then reloads it on
+// a background thread whenever it changes, until the surface is released.
+// Returns an error if the first load, or starting to watch, fails.
+icon_bitmap_error watch_icon_file(const std::wstring& path,
+                                  std::shared_ptr<IconSurface> surface);
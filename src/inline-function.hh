@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 96>
+class InlineFunction;
+
+// Like std::function, but move-only and never allocating: the callable is
+// always stored inline, and must fit in `Capacity` bytes, which is checked at
+// compile time. Capture large state by pointer or reference instead.
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {}
+
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<
+                            std::decay_t<F>, InlineFunction>>>
+  InlineFunction(F&& f) {
+    using T = std::decay_t<F>;
+    static_assert(sizeof(T) <= Capacity,
+                  "Callable is too large for InlineFunction");
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Callable is over-aligned for InlineFunction");
+    new (&storage) T(std::forward<F>(f));
+    ops = &ops_for<T>;
+  }
+
+  InlineFunction(InlineFunction&& other) noexcept { move_from(other); }
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const { return ops != nullptr; }
+
+  R operator()(Args... args) {
+    return ops->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+  void reset() {
+    if (ops) {
+      std::exchange(ops, nullptr)->destroy(&storage);
+    }
+  }
+
+ private:
+  struct operations {
+    R (*invoke)(void* self, Args&&... args);
+    // Move constructs into `to`, and destroys `from`.
+    void (*relocate)(void* from, void* to);
+    void (*destroy)(void* self);
+  };
+
+  template <typename T>
+  static constexpr operations ops_for = {
+      [](void* self, Args&&... args) -> R {
+        return (*static_cast<T*>(self))(std::forward<Args>(args)...);
+      },
+      [](void* from, void* to) {
+        new (to) T(std::move(*static_cast<T*>(from)));
+        static_cast<T*>(from)->~T();
+      },
+      [](void* self) { static_cast<T*>(self)->~T(); },
+  };
+
+  void move_from(InlineFunction& other) {
+    if (other.ops) {
+      other.ops->relocate(&other.storage, &storage);
+      ops = std::exchange(other.ops, nullptr);
+    }
+  }
+
+  const operations* ops = nullptr;
+  alignas(std::max_align_t) unsigned char storage[Capacity];
+};
@@ -230,30 +230,31 @@ napi_value export_Menu_show(napi_env env, napi_callback_info info) {
   }
 
   HMENU menu = this_object->menu;
+  HWND hwnd = env_data->icon_message_loop.hwnd;
 
   napi_deferred deferred;
   napi_value promise;
   NAPI_THROW_RETURN_NULL_IF_NOT_OK(
       env, napi_create_promise(env, &deferred, &promise));
 
-  env_data->icon_message_loop.run_on_msg_thread_nonblocking([=] {
-    auto env_data = get_env_data(env);
-    if (!env_data) {
-      return;
-    }
-
+  auto show = [=] {
     int32_t item_id = 0;
     DWORD error = 0;
     item_id = (int32_t)TrackPopupMenuEx(
         menu,
         GetSystemMetrics(SM_MENUDROPALIGNMENT) | TPM_RETURNCMD | TPM_NONOTIFY,
-        mouse_x, mouse_y, env_data->icon_message_loop.hwnd, nullptr);
+        mouse_x, mouse_y, hwnd, nullptr);
     if (!item_id) {
       error = GetLastError();
     }
 
-    env_data->icon_message_loop.run_on_env_thread.blocking(
-        [=](napi_env env, napi_value) {
+    // Not held while the menu is open, so the environment can be torn down.
+    auto env_data = lock_env_data(env);
+    if (!env_data) {
+      return;
+    }
+    env_data->icon_message_loop.post_to_env_thread(
+        [=](napi_env env) {
           if (error) {
             napi_value error_value;
             NAPI_THROW_RETURN_VOID_IF_NOT_OK(
@@ -269,8 +270,12 @@ napi_value export_Menu_show(napi_env env, napi_callback_info info) {
             NAPI_THROW_RETURN_VOID_IF_NOT_OK(
                 env, napi_resolve_deferred(env, deferred, result));
           }
-        });
-  });
+        },
+        NotifyIconMessageLoop::required);
+  };
+  // TrackPopupMenuEx() dispatches messages until the menu closes.
+  env_data->icon_message_loop.run_on_msg_thread_nonblocking(std::move(show),
+                                                            true);
 
   return promise;
 }
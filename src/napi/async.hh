@@ -219,12 +219,11 @@ struct NapiThreadsafeFunctionBase {
     return value.create(env, func, call_js, resource_object, resource_name,
                         context, max_queue_size);
   }
-};
-
-struct NapiThreadsafeFunction : NapiThreadsafeFunctionBase {
-  using CallData = std::function<void(napi_env, napi_value)>;
 
-  napi_status create(napi_env env, int max_queue_size = 0) {
+  // As create(), for a `call_js` that doesn't call a JS function.
+  napi_status create_native(napi_env env,
+                            napi_threadsafe_function_call_js call_js,
+                            void* context = nullptr, int max_queue_size = 0) {
     napi_value func = nullptr;
     const napi_node_version* v;
     if (napi_get_node_version(env, &v) != napi_ok ||
@@ -236,7 +235,15 @@ struct NapiThreadsafeFunction : NapiThreadsafeFunctionBase {
           [](napi_env, napi_callback_info) -> napi_value { return nullptr; },
           nullptr, &func));
     }
-    return create(env, func, max_queue_size);
+    return create(env, func, call_js, context, max_queue_size);
+  }
+};
+
+struct NapiThreadsafeFunction : NapiThreadsafeFunctionBase {
+  using CallData = std::function<void(napi_env, napi_value)>;
+
+  napi_status create(napi_env env, int max_queue_size = 0) {
+    return create_native(env, call_js, nullptr, max_queue_size);
   }
 
   napi_status create(napi_env env, napi_value func, int max_queue_size = 0) {
@@ -1,8 +1,12 @@
 #include "notify-icon-message-loop.hh"
+#include "command-ring.hh"
 #include "data.hh"
+#include "icon-surface.hh"
 #include "unique.hh"
 
+#include <algorithm>
 #include <future>
+#include <thread>
 #include <variant>
 
 #include <shellapi.h>
@@ -20,6 +24,9 @@ constexpr auto WM_USER_CALL = WM_USER + 1;
 constexpr auto WM_USER_NOTIFICATION_ICON = WM_USER + 2;
 
 static ATOM windowClassId = 0;
+// Broadcast to top-level windows when the taskbar is (re)created, e.g. after
+// explorer.exe restarts, at which point all notify icons have been lost.
+static UINT taskbar_created_message = 0;
 
 struct MsgThreadError {
   const char* syscall;
@@ -27,8 +34,126 @@ struct MsgThreadError {
 };
 using MsgThreadInitResult = std::variant<MsgThreadError, HWND>;
 
-void msg_thread_proc(napi_env env,
-                     std::promise<MsgThreadInitResult>& init_result);
+void msg_thread_proc(std::promise<MsgThreadInitResult>& init_result);
+
+// Sent as lParam of WM_USER_CALL with wParam 0.
+struct msg_thread_blocking_call {
+  void (*invoke)(void* body);
+  void* body;
+};
+
+// The message thread and window shared by every environment, running while
+// any of them has called NotifyIconMessageLoop::init() without quit().
+struct message_pump {
+  // Starts the thread for the first user.
+  MsgThreadInitResult acquire() {
+    std::lock_guard lock{users_mutex};
+    if (users) {
+      users++;
+      return hwnd.load();
+    }
+
+    std::promise<MsgThreadInitResult> msg_thread_init;
+    auto msg_thread_init_promise = msg_thread_init.get_future();
+    thread = std::thread(&msg_thread_proc, std::ref(msg_thread_init));
+    auto init_result = msg_thread_init_promise.get();
+    if (auto new_hwnd = std::get_if<HWND>(&init_result)) {
+      hwnd = *new_hwnd;
+      users++;
+    } else {
+      thread.join();
+    }
+    return init_result;
+  }
+
+  // Stops the thread after the last user, dropping any calls not yet run.
+  void release() {
+    std::lock_guard lock{users_mutex};
+    if (--users) {
+      return;
+    }
+    PostMessage(hwnd.exchange(nullptr), WM_USER_QUIT, 0, 0);
+    thread.join();
+
+    CallQueue<queued_call> dropped;
+    {
+      std::lock_guard queue_lock{queue_mutex};
+      std::swap(dropped, queue);
+      queue_posted = false;
+    }
+  }
+
+  void post(NotifyIconMessageLoop::MsgCall body, bool modal) {
+    std::lock_guard lock{queue_mutex};
+    auto current_hwnd = hwnd.load();
+    if (!current_hwnd) {
+      return;
+    }
+    queue.push({std::move(body), modal});
+    if (queue_posted) {
+      return;
+    }
+    queue_posted = PostMessage(current_hwnd, WM_USER_CALL, 1,
+                               reinterpret_cast<LPARAM>(this));
+  }
+
+  void send(void (*invoke)(void* body), void* body) {
+    msg_thread_blocking_call call{invoke, body};
+    SendMessage(hwnd, WM_USER_CALL, 0, reinterpret_cast<LPARAM>(&call));
+  }
+
+  // Called on the message thread for the message posted for each batch.
+  void run_calls() {
+    // Only the calls queued before this message, and let later calls post
+    // again, so they still run if one of these runs a modal loop.
+    size_t count;
+    {
+      std::lock_guard lock{queue_mutex};
+      count = queue.size();
+      queue_posted = false;
+    }
+
+    queued_call call;
+    while (count--) {
+      {
+        std::lock_guard lock{queue_mutex};
+        // Already run by a nested modal loop.
+        if (!queue.pop(&call)) {
+          return;
+        }
+        // The modal loop will dispatch this, running the rest of the batch.
+        if (call.modal && !queue.empty() && !queue_posted) {
+          queue_posted = PostMessage(hwnd, WM_USER_CALL, 1,
+                                     reinterpret_cast<LPARAM>(this));
+        }
+      }
+      call.body();
+    }
+  }
+
+  std::atomic<HWND> hwnd = nullptr;
+
+ private:
+  std::mutex users_mutex;
+  int32_t users = 0;
+  std::thread thread;
+
+  struct queued_call {
+    NotifyIconMessageLoop::MsgCall body;
+    bool modal = false;
+  };
+
+  std::mutex queue_mutex;
+  CallQueue<queued_call> queue;
+  bool queue_posted = false;
+};
+
+// Never destroyed, so there's no joinable thread to terminate the process
+// with if an environment is still using it at exit.
+static message_pump& get_message_pump() {
+  static auto pump = new message_pump();
+  return *pump;
+}
 
 NotifyIconMessageLoop::~NotifyIconMessageLoop() { quit(); }
 
@@ -37,13 +162,11 @@ UINT NotifyIconMessageLoop::notify_message() {
 }
 
 napi_status NotifyIconMessageLoop::init(EnvData* data) {
-  std::promise<MsgThreadInitResult> msg_thread_init;
-  auto msg_thread_init_promise = msg_thread_init.get_future();
-  auto env = data->env;
-
-  thread = std::thread(&msg_thread_proc, env, std::ref(msg_thread_init));
-  auto init_result = msg_thread_init_promise.get();
+  if (hwnd) {
+    return napi_ok;
+  }
 
+  auto init_result = get_message_pump().acquire();
   if (auto error = std::get_if<MsgThreadError>(&init_result); error) {
     NAPI_RETURN_IF_NOT_OK(
         napi_throw_win32_error(data->env, error->syscall, error->code));
@@ -55,48 +178,213 @@ napi_status NotifyIconMessageLoop::init(EnvData* data) {
 }
 
 void NotifyIconMessageLoop::quit() {
-  if (thread.joinable()) {
-    PostMessage(hwnd, WM_USER_QUIT, 0, 0);
-    thread.join();
+  if (hwnd) {
+    hwnd = nullptr;
+    get_message_pump().release();
   }
 }
 
 void NotifyIconMessageLoop::run_on_msg_thread_blocking_(
-    unique_function<void()> body) {
-  SendMessage(hwnd, WM_USER_CALL, 0, reinterpret_cast<LPARAM>(body.get()));
+    void (*invoke)(void* body), void* body) {
+  get_message_pump().send(invoke, body);
+}
+
+void NotifyIconMessageLoop::run_on_msg_thread_nonblocking(MsgCall body,
+                                                          bool modal) {
+  get_message_pump().post(std::move(body), modal);
+}
+
+napi_status NotifyIconMessageLoop::create_env_queue(napi_env env) {
+  return env_queue_function.create_native(
+      env,
+      [](napi_env env, napi_value, void* context, void*) {
+        static_cast<NotifyIconMessageLoop*>(context)->run_env_calls(env);
+      },
+      this);
+}
+
+void NotifyIconMessageLoop::post_to_env_thread(EnvCall body,
+                                               env_call_kind kind) {
+  {
+    std::lock_guard lock{env_queue_mutex};
+    if (kind == droppable && env_queue.size() >= env_queue_limit) {
+      env_stats.dropped++;
+      return;
+    }
+    env_queue.push(std::move(body));
+    env_stats.high_water =
+        std::max<uint64_t>(env_stats.high_water, env_queue.size());
+    if (std::exchange(env_queue_scheduled, true)) {
+      return;
+    }
+    env_stats.batches++;
+  }
+
+  // No call data, the batch is in env_queue. If this fails the environment is
+  // closing and nothing will run: the calls are left to be destroyed with the
+  // loop, on the JS thread, as they may own JS references.
+  env_queue_function.value.call_nonblocking(nullptr);
+}
+
+void NotifyIconMessageLoop::run_env_calls(napi_env env) {
+  size_t count;
+  {
+    std::lock_guard lock{env_queue_mutex};
+    count = env_queue.size();
+    env_queue_scheduled = false;
+  }
+
+  EnvCall call;
+  while (count--) {
+    {
+      std::lock_guard lock{env_queue_mutex};
+      if (!env_queue.pop(&call)) {
+        return;
+      }
+    }
+
+    // Run it regardless, in the threadsafe function call's scope, as required
+    // calls must never be dropped.
+    napi_handle_scope scope;
+    bool scoped = napi_open_handle_scope(env, &scope) == napi_ok;
+    call(env);
+    // As if each call was its own threadsafe function call, so one throwing
+    // doesn't stop the rest.
+    bool pending;
+    if (napi_is_exception_pending(env, &pending) == napi_ok && pending) {
+      napi_value error;
+      if (napi_get_and_clear_last_exception(env, &error) == napi_ok) {
+        napi_fatal_exception(env, error);
+      }
+    }
+    if (scoped) {
+      napi_close_handle_scope(env, scope);
+    }
+  }
+}
+
+NotifyIconMessageLoop::env_queue_stats
+NotifyIconMessageLoop::get_env_queue_stats() {
+  std::lock_guard lock{env_queue_mutex};
+  auto stats = env_stats;
+  stats.depth = env_queue.size();
+  return stats;
+}
+
+struct msg_thread_timer {
+  // Only compared, as it may have been destroyed by the time the timer fires.
+  NotifyIconMessageLoop* owner;
+  NotifyIconMessageLoop::TimerCall body;
+};
+
+// Only used on the message thread, which is shared by every environment.
+static thread_local std::unordered_map<UINT_PTR, msg_thread_timer> timers;
+
+void NotifyIconMessageLoop::set_timer(UINT_PTR id, UINT delay_ms,
+                                      TimerCall body) {
+  run_on_msg_thread_nonblocking(
+      [this, hwnd = hwnd, id, delay_ms, body = std::move(body)]() mutable {
+        if (SetTimer(hwnd, id, delay_ms, nullptr)) {
+          timers[id] = {this, std::move(body)};
+        }
+      });
 }
 
-void NotifyIconMessageLoop::run_on_msg_thread_nonblocking_(
-    unique_function<void()> body) {
-  if (PostMessage(hwnd, WM_USER_CALL, 1,
-                  reinterpret_cast<LPARAM>(body.get()))) {
-    body.release();
+void NotifyIconMessageLoop::kill_timers() {
+  auto msg_hwnd = get_message_pump().hwnd.load();
+  for (auto it = timers.begin(); it != timers.end();) {
+    if (it->second.owner == this) {
+      KillTimer(msg_hwnd, it->first);
+      it = timers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// The event for a notify icon callback message, other than select, if any.
+static notify_icon_event get_notify_icon_event(UINT msg) {
+  switch (msg) {
+    case WM_MOUSEMOVE:
+      return notify_icon_event_mouse_move;
+    case NIN_BALLOONSHOW:
+      return notify_icon_event_balloon_show;
+    case NIN_BALLOONHIDE:
+      return notify_icon_event_balloon_hide;
+    case NIN_BALLOONTIMEOUT:
+      return notify_icon_event_balloon_timeout;
+    case NIN_BALLOONUSERCLICK:
+      return notify_icon_event_balloon_click;
+    case NIN_POPUPOPEN:
+      return notify_icon_event_popup_open;
+    case NIN_POPUPCLOSE:
+      return notify_icon_event_popup_close;
+    default:
+      return {};
   }
 }
 
 LRESULT messageWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+  if (msg == taskbar_created_message && msg) {
+    restore_all_icons(hwnd);
+    return 0;
+  }
+
   switch (msg) {
-    case WM_CREATE: {
-      auto pcs = (CREATESTRUCTW*)lParam;
-      SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)pcs->lpCreateParams);
-      break;
-    }
     case WM_USER_QUIT: {
       // https://devblogs.microsoft.com/oldnewthing/20090112-00/?p=19533
       ::PostQuitMessage(wParam);
       break;
     }
     case WM_USER_CALL: {
-      auto body_ptr = reinterpret_cast<std::function<void()>*>(lParam);
-      unique_function<void()> unique_body_ptr;
       if (wParam) {
-        unique_body_ptr.reset(body_ptr);
+        reinterpret_cast<message_pump*>(lParam)->run_calls();
+      } else {
+        auto call = reinterpret_cast<msg_thread_blocking_call*>(lParam);
+        call->invoke(call->body);
+      }
+      break;
+    }
+    case WM_TIMER: {
+      KillTimer(hwnd, wParam);
+      if (auto it = timers.find(wParam); it != timers.end()) {
+        auto body = std::move(it->second.body);
+        timers.erase(it);
+        body();
+      }
+      break;
+    }
+    case WM_USER_SURFACE_COMMIT: {
+      if (auto surface = find_icon_surface((int32_t)wParam)) {
+        surface->publish(hwnd);
+      }
+      break;
+    }
+    case WM_USER_COMMAND_RING: {
+      if (auto ring = find_command_ring((int32_t)wParam)) {
+        ring->drain();
       }
-      (*body_ptr)();
       break;
     }
     case WM_USER_NOTIFICATION_ICON: {
+      if (auto type = get_notify_icon_event(LOWORD(lParam))) {
+        if (auto env_data = lock_icon_env_data(HIWORD(lParam))) {
+          EnvData::NotifyEventArgs args;
+          args.icon_id = HIWORD(lParam);
+          args.type = type;
+          args.mouse_x = (int16_t)LOWORD(wParam);
+          args.mouse_y = (int16_t)HIWORD(wParam);
+          env_data->notify_event(args);
+        }
+      }
+
       switch (LOWORD(lParam)) {
+        case NIN_POPUPOPEN: {
+          if (auto env_data = lock_icon_env_data(HIWORD(lParam))) {
+            env_data->notify_tooltip_request(HIWORD(lParam));
+          }
+          break;
+        }
         case NIN_SELECT:
         case NIN_KEYSELECT:
         case WM_CONTEXTMENU:
@@ -105,7 +393,6 @@ LRESULT messageWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
           // take foreground while responding to user interaction.
           SetForegroundWindow(hwnd);
 
-          auto env = (napi_env)(void*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
           auto icon_id = HIWORD(lParam);
           EnvData::NotifySelectArgs args;
           args.right_button = LOWORD(lParam) == WM_CONTEXTMENU;
@@ -114,8 +401,16 @@ LRESULT messageWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
           args.mouse_x = (int16_t)LOWORD(wParam);
           args.mouse_y = (int16_t)HIWORD(wParam);
 
-          if (auto env_data = get_env_data(env); env_data) {
+          if (auto env_data = lock_icon_env_data(icon_id)) {
             env_data->notify_select(icon_id, args);
+
+            EnvData::NotifyEventArgs event_args;
+            event_args.icon_id = icon_id;
+            event_args.type = notify_icon_event_select;
+            event_args.right_button = args.right_button;
+            event_args.mouse_x = args.mouse_x;
+            event_args.mouse_y = args.mouse_y;
+            env_data->notify_event(event_args);
           }
       }
       break;
@@ -125,8 +420,7 @@ LRESULT messageWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
   return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
-void msg_thread_proc(napi_env env,
-                     std::promise<MsgThreadInitResult>& init_result) {
+void msg_thread_proc(std::promise<MsgThreadInitResult>& init_result) {
   auto hInstance = get_image_instance();
 
   if (!windowClassId) {
@@ -140,6 +434,7 @@ void msg_thread_proc(napi_env env,
           MsgThreadError{"RegisterClassW", GetLastError()});
       return;
     }
+    taskbar_created_message = RegisterWindowMessageW(L"TaskbarCreated");
   }
 
   // Please give me the real screen positions of clicks.
@@ -155,9 +450,11 @@ void msg_thread_proc(napi_env env,
   auto old_dpi_awareness =
       SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
+  // A hidden top-level window rather than message-only (HWND_MESSAGE), as
+  // those don't get broadcasts such as TaskbarCreated.
   WndHandle hwnd =
       CreateWindowW((LPWSTR)windowClassId, L"Tray Message Window", 0, 0, 0, 0,
-                    0, HWND_MESSAGE, nullptr, hInstance, env);
+                    0, nullptr, nullptr, hInstance, nullptr);
 
   SetThreadDpiAwarenessContext(old_dpi_awareness);
 
@@ -167,6 +464,10 @@ void msg_thread_proc(napi_env env,
     return;
   }
 
+  // Otherwise blocked by UIPI if we're elevated and explorer.exe isn't.
+  ChangeWindowMessageFilterEx(hwnd, taskbar_created_message, MSGFLT_ALLOW,
+                              nullptr);
+
   init_result.set_value(hwnd);
 
   MSG msg = {};
@@ -3,43 +3,97 @@
 // Prevent pulling in winsock.h in windows.h, which breaks uv.h
 #define WIN32_LEAN_AND_MEAN
 
-#include <functional>
-#include <thread>
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <Windows.h>
 
+#include "call-queue.hh"
+#include "inline-function.hh"
 #include "napi/async.hh"
 
-template <typename T>
-using unique_function = std::unique_ptr<std::function<T>>;
-
 struct EnvData;
 
+// An environment's use of the message thread, which is shared by every
+// environment in the process, e.g. worker threads, along with its window.
+// Messages for notify icons are routed back to the environment that owns the
+// icon by its id, which is unique across the process.
 struct NotifyIconMessageLoop {
+  // The shared message window, while init() has been called without quit().
   HWND hwnd = nullptr;
-  std::thread thread;
-  NapiThreadsafeFunction run_on_env_thread;
+
+  using MsgCall = InlineFunction<void()>;
+  // Small enough to be queued within a MsgCall by set_timer().
+  using TimerCall = InlineFunction<void(), 32>;
+  using EnvCall = InlineFunction<void(napi_env)>;
+  enum env_call_kind {
+    // Dropped if env_queue_limit calls are already waiting, e.g. input events
+    // the user will repeat if nothing happens.
+    droppable,
+    // Never dropped, e.g. settling a promise.
+    required,
+  };
+  struct env_queue_stats {
+    uint64_t depth = 0;
+    uint64_t high_water = 0;
+    uint64_t dropped = 0;
+    // Threadsafe function calls made, each running every call waiting.
+    uint64_t batches = 0;
+  };
+
+  // Creates the threadsafe function post_to_env_thread() wakes the JS thread
+  // with, on the JS thread.
+  napi_status create_env_queue(napi_env env);
+
+  // Queues `body` to run on the JS thread without ever blocking the caller.
+  // Calls are run in order, in batches, with one non-blocking threadsafe
+  // function call for each batch. Can be called from any thread.
+  void post_to_env_thread(EnvCall body, env_call_kind kind);
+  env_queue_stats get_env_queue_stats();
+  std::atomic<uint32_t> env_queue_limit = 1024;
 
   ~NotifyIconMessageLoop();
 
   UINT notify_message();
 
+  // Starts the message thread if no other environment is using it.
   napi_status init(EnvData* data);
+  // Stops the message thread if no other environment is using it.
   void quit();
 
-  void run_on_msg_thread_blocking_(unique_function<void()> body);
-  void run_on_msg_thread_nonblocking_(unique_function<void()> body);
+  // Queues `body` to run on the message thread, in order, in batches with one
+  // posted message for each batch. Can be called from any thread. Dropped if
+  // the message thread isn't running. Set `modal` if `body` runs a modal loop,
+  // e.g. TrackPopupMenuEx(), so the calls after it run from that loop rather
+  // than waiting for it to end.
+  void run_on_msg_thread_nonblocking(MsgCall body, bool modal = false);
 
+  // Runs `body` on the message thread, returning once it has. `body` is
+  // called in place, so it can capture anything by reference.
   template <typename Body>
   void run_on_msg_thread_blocking(Body&& body) {
     run_on_msg_thread_blocking_(
-        std::make_unique<std::function<void()>>(std::move(body)));
+        [](void* body) { (*static_cast<std::decay_t<Body>*>(body))(); },
+        &body);
   }
 
-  template <typename Body>
-  void run_on_msg_thread_nonblocking(Body&& body) {
-    run_on_msg_thread_nonblocking_(
-        std::make_unique<std::function<void()>>(std::move(body)));
-  }
+  // Calls `body` on the message thread once `delay_ms` has passed, replacing
+  // any timer already set with `id`, which is shared by every environment, so
+  // should be derived from an icon id. Can be called from any thread.
+  void set_timer(UINT_PTR id, UINT delay_ms, TimerCall body);
+  // On the message thread, kills the timers set with this loop that haven't
+  // fired yet, e.g. as its environment is torn down.
+  void kill_timers();
+
+ private:
+  void run_on_msg_thread_blocking_(void (*invoke)(void* body), void* body);
+  void run_env_calls(napi_env env);
+
+  NapiThreadsafeFunctionBase env_queue_function;
+  std::mutex env_queue_mutex;
+  CallQueue<EnvCall> env_queue;
+  bool env_queue_scheduled = false;
+  env_queue_stats env_stats;
 };
@@ -1,4 +1,6 @@
 #include "notify-icon-object.hh"
+
+#include "bounded-text.hh"
 #include "icon-object.hh"
 #include "parse_guid.hh"
 
@@ -78,6 +80,16 @@ struct notify_icon_object_options : notify_icon_options {
   std::optional<IconObject::Ref> icon_ref;
   std::optional<object_notification_options> object_notification;
   std::optional<NapiAsyncCallback> select_callback;
+  std::optional<NapiAsyncCallback> events_callback;
+  std::optional<NapiAsyncCallback> events_available_callback;
+  std::optional<uint32_t> event_mask;
+  std::optional<uint32_t> event_buffer_size;
+  std::optional<NotifyIconShell::event_overflow_policy> event_overflow;
+  std::optional<uint32_t> tooltip_min_interval_ms;
+  std::optional<NapiAsyncCallback> tooltip_request_callback;
+  std::optional<uint32_t> tooltip_ttl_ms;
+  std::optional<uint32_t> notification_min_interval_ms;
+  std::optional<uint32_t> notification_queue_limit;
 };
 
 struct notify_icon_add_options : notify_icon_object_options {
@@ -112,6 +124,7 @@ napi_status napi_get_value(
                          // being cleared.
       options->icon.emplace(nullptr);
     } else {
+      NAPI_RETURN_IF_NOT_OK(icon_object->materialize(env));
       options->icon.emplace(icon_object->icon);
       // If this condition is false, then Shell_NotifyIcon() will error.
       options->large_icon = icon_object->width == GetSystemMetrics(SM_CXICON) &&
@@ -123,22 +136,103 @@ napi_status napi_get_value(
       napi_get_named_property(env, value, "title", &options->title));
   NAPI_RETURN_IF_NOT_OK(
       napi_get_named_property(env, value, "text", &options->text));
+
+  std::optional<int32_t> priority;
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "priority", &priority));
+  options->priority = priority.value_or(0);
   return napi_ok;
 }
 
-void set_optional_hicon_from_ref(
-    std::optional<HICON>& hicon,
+napi_status set_optional_hicon_from_ref(
+    napi_env env, std::optional<HICON>& hicon,
     std::optional<NapiUnwrappedRef<IconObject>> const& ref) {
   // Not provided, means don't change existing value: !hicon
-  if (!ref) return;
+  if (!ref) return napi_ok;
 
   auto icon_object = ref.value().wrapped;
   if (!icon_object) {
     // `icon: null`, means clear existing value: hicon && !hicon.value()
     hicon.emplace(nullptr);
   } else {
+    NAPI_RETURN_IF_NOT_OK(icon_object->materialize(env));
     hicon.emplace(icon_object->icon);
   }
+  return napi_ok;
+}
+
+struct notify_icon_event_info {
+  std::string_view name;
+  notify_icon_event type;
+};
+
+static constexpr notify_icon_event_info notify_icon_events[] = {
+    {"mouseMove", notify_icon_event_mouse_move},
+    {"balloonShow", notify_icon_event_balloon_show},
+    {"balloonHide", notify_icon_event_balloon_hide},
+    {"balloonTimeout", notify_icon_event_balloon_timeout},
+    {"balloonClick", notify_icon_event_balloon_click},
+    {"popupOpen", notify_icon_event_popup_open},
+    {"popupClose", notify_icon_event_popup_close},
+    {"select", notify_icon_event_select},
+};
+
+std::string_view notify_icon_event_name(notify_icon_event type) {
+  for (auto& info : notify_icon_events) {
+    if (info.type == type) {
+      return info.name;
+    }
+  }
+  return {};
+}
+
+static napi_status get_event_mask(napi_env env, napi_value value,
+                                  std::optional<uint32_t>* result) {
+  std::optional<std::vector<std::string>> names;
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "events", &names));
+  if (!names) {
+    return napi_ok;
+  }
+
+  uint32_t mask = 0;
+  for (auto& name : names.value()) {
+    auto it = std::find_if(
+        std::begin(notify_icon_events), std::end(notify_icon_events),
+        [&](const notify_icon_event_info& info) { return info.name == name; });
+    if (it == std::end(notify_icon_events)) {
+      napi_throw_type_error(env, nullptr,
+                            ("Unknown event \""s + name + "\"."s).c_str());
+      return napi_pending_exception;
+    }
+    mask |= it->type;
+  }
+  *result = mask;
+  return napi_ok;
+}
+
+static napi_status get_event_overflow(
+    napi_env env, napi_value value,
+    std::optional<NotifyIconShell::event_overflow_policy>* result) {
+  std::optional<std::string> name;
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "eventOverflow", &name));
+  if (!name) {
+    return napi_ok;
+  }
+  if (name == "dropOldest") {
+    *result = NotifyIconShell::drop_oldest;
+  } else if (name == "dropNewest") {
+    *result = NotifyIconShell::drop_newest;
+  } else if (name == "coalesce") {
+    *result = NotifyIconShell::coalesce;
+  } else {
+    napi_throw_type_error(
+        env, nullptr,
+        "eventOverflow must be \"dropOldest\", \"dropNewest\" or "
+        "\"coalesce\".");
+    return napi_pending_exception;
+  }
+  return napi_ok;
 }
 
 napi_status get_icon_options_common(napi_env env, napi_value value,
@@ -146,7 +240,8 @@ napi_status get_icon_options_common(napi_env env, napi_value value,
   NAPI_RETURN_IF_NOT_OK(
       napi_get_named_property(env, value, "icon", &options->icon_ref));
 
-  set_optional_hicon_from_ref(options->icon, options->icon_ref);
+  NAPI_RETURN_IF_NOT_OK(
+      set_optional_hicon_from_ref(env, options->icon, options->icon_ref));
 
   NAPI_RETURN_IF_NOT_OK(
       napi_get_named_property(env, value, "tooltip", &options->tooltip));
@@ -155,8 +250,9 @@ napi_status get_icon_options_common(napi_env env, napi_value value,
   NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "notification",
                                                 &options->object_notification));
   if (options->object_notification) {
-    set_optional_hicon_from_ref(options->object_notification->icon,
-                                options->object_notification->icon_ref);
+    NAPI_RETURN_IF_NOT_OK(set_optional_hicon_from_ref(
+        env, options->object_notification->icon,
+        options->object_notification->icon_ref));
     // Deliberate slicing. This is a bit clumsy, but it's the simplest solution
     // that still clearly separates the notify_icon stuff from the N-API
     // ownership stuff.
@@ -164,6 +260,29 @@ napi_status get_icon_options_common(napi_env env, napi_value value,
   }
   NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "onSelect",
                                                 &options->select_callback));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "onEvents",
+                                                &options->events_callback));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "onEventsAvailable",
+                              &options->events_available_callback));
+  NAPI_RETURN_IF_NOT_OK(get_event_mask(env, value, &options->event_mask));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(
+      env, value, "eventBufferSize", &options->event_buffer_size));
+  NAPI_RETURN_IF_NOT_OK(
+      get_event_overflow(env, value, &options->event_overflow));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(
+      env, value, "tooltipMinIntervalMs", &options->tooltip_min_interval_ms));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "onTooltipRequest",
+                              &options->tooltip_request_callback));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "tooltipTtlMs",
+                                                &options->tooltip_ttl_ms));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(
+      env, value, "notificationMinIntervalMs",
+      &options->notification_min_interval_ms));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "notificationQueueLimit",
+                              &options->notification_queue_limit));
   return napi_ok;
 }
 
@@ -194,54 +313,685 @@ napi_status napi_get_value(napi_env env, napi_value value,
   return napi_ok;
 }
 
+bool NotifyIconShell::add(const notify_icon_id& new_id,
+                          const notify_icon_options& options) {
+  if (!loop || !icon.add(new_id, options, loop->notify_message())) {
+    return false;
+  }
+  auto now = clock::now();
+  if (options.tooltip) {
+    tooltip_sent_at = now;
+    tooltips_sent++;
+  }
+  if (options.notification) {
+    notification_sent_at = now;
+    notifications_sent++;
+  }
+  return true;
+}
+
+bool NotifyIconShell::restore() {
+  std::lock_guard lock{mutex};
+  return loop && icon.restore(loop->notify_message());
+}
+
+void NotifyIconShell::detach() {
+  std::lock_guard lock{mutex};
+  loop = nullptr;
+  set_tooltip_updater(nullptr);
+  pending_tooltip.reset();
+  notification_queue.clear();
+  notification_queue_depth = 0;
+}
+
+NotifyIconShell::push_event_result NotifyIconShell::push_event(
+    const EnvData::NotifyEventArgs& args) {
+  std::lock_guard lock{events_mutex};
+  push_event_result result;
+
+  auto merge_with = events.end();
+  if (args.type == notify_icon_event_mouse_move ||
+      (event_overflow == coalesce && events.size() >= event_buffer_size)) {
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+      if (it->type == args.type) {
+        merge_with = std::prev(it.base());
+        break;
+      }
+    }
+  }
+
+  if (merge_with != events.end()) {
+    events.erase(merge_with);
+    result.merged = true;
+  } else if (events.size() >= event_buffer_size) {
+    result.dropped = true;
+    events_dropped++;
+    if (event_overflow == drop_newest) {
+      return result;
+    }
+    events.pop_front();
+  }
+  events.push_back(args);
+
+  result.wake = !std::exchange(events_woken, true);
+  return result;
+}
+
+std::vector<EnvData::NotifyEventArgs> NotifyIconShell::take_events(
+    size_t max) {
+  std::lock_guard lock{events_mutex};
+  auto count = std::min(max, events.size());
+  std::vector<EnvData::NotifyEventArgs> result{events.begin(),
+                                               events.begin() + count};
+  events.erase(events.begin(), events.begin() + count);
+  if (events.empty()) {
+    events_woken = false;
+  }
+  return result;
+}
+
+static bool is_notification_removal(
+    const notify_icon_options::notification_options& options) {
+  return options.title.value_or(std::wstring{}).empty() &&
+         options.text.value_or(std::wstring{}).empty();
+}
+
+bool NotifyIconShell::modify(notify_icon_options options) {
+  auto now = clock::now();
+
+  if (options.tooltip) {
+    auto due = tooltip_sent_at + tooltip_min_interval.load();
+    if (pending_tooltip) {
+      // The timer is already set, it will send this one instead.
+      tooltips_dropped++;
+      pending_tooltip = std::exchange(options.tooltip, std::nullopt);
+    } else if (now < due) {
+      pending_tooltip = std::exchange(options.tooltip, std::nullopt);
+      schedule(due);
+    } else {
+      tooltip_sent_at = now;
+      tooltips_sent++;
+    }
+  }
+
+  if (options.notification && notification_min_interval.load().count()) {
+    auto due = notification_sent_at + notification_min_interval.load();
+    if (is_notification_removal(options.notification.value())) {
+      // Nothing waiting should be shown after the current one is removed.
+      notification_queue.clear();
+      notification_queue_depth = 0;
+    } else if (notification_queue_limit.load() &&
+               (!notification_queue.empty() || now < due)) {
+      queue_notification(std::move(options.notification.value()));
+      options.notification.reset();
+      schedule(due);
+    }
+  }
+
+  if (options.notification) {
+    if (is_notification_removal(options.notification.value())) {
+      shown_notification.reset();
+    } else {
+      shown_notification = {options.notification->title,
+                            options.notification->text};
+      notification_sent_at = now;
+      notifications_sent++;
+    }
+  }
+  return icon.modify(options);
+}
+
+bool NotifyIconShell::modify(const notify_icon_prepared_modify& prepared) {
+  if (prepared.options.tooltip) {
+    // Replaces any held back tooltip, as a normal update would.
+    if (pending_tooltip) {
+      tooltips_dropped++;
+      pending_tooltip.reset();
+    }
+    tooltip_sent_at = clock::now();
+    tooltips_sent++;
+  }
+  return icon.modify(prepared);
+}
+
+// Kept apart from the timer for held back updates, which uses the icon id.
+// Timer ids are shared by every environment, and icon ids are positive int32s
+// (see NotifyIconObject::init()), so always below this bit, even on 32-bit.
+constexpr UINT_PTR tooltip_update_timer_flag = (UINT_PTR)1 << 31;
+
+void NotifyIconShell::set_tooltip_updater(
+    std::unique_ptr<TooltipUpdater> updater) {
+  tooltip_updater = std::move(updater);
+  tooltip_updater_generation++;
+  if (tooltip_updater) {
+    schedule_tooltip_update(0);
+  }
+}
+
+void NotifyIconShell::schedule_tooltip_update(DWORD delay_ms) {
+  if (!loop) {
+    return;
+  }
+  loop->set_timer(tooltip_update_timer_flag | (uint32_t)icon.id.callback_id,
+                  delay_ms,
+                  [self = shared_from_this(),
+                   generation = tooltip_updater_generation] {
+                    self->update_tooltip(generation);
+                  });
+}
+
+// On the message thread.
+void NotifyIconShell::update_tooltip(uint32_t generation) {
+  std::lock_guard lock{mutex};
+  // Replaced or removed since.
+  if (!tooltip_updater || generation != tooltip_updater_generation ||
+      !icon.id) {
+    return;
+  }
+
+  notify_icon_options options;
+  if (tooltip_updater->poll(&options.tooltip.emplace())) {
+    if (pending_tooltip) {
+      tooltips_dropped++;
+      pending_tooltip.reset();
+    }
+    tooltip_sent_at = clock::now();
+    tooltips_sent++;
+    tooltip_updater_sent++;
+    // There's nothing to report an error to, the next change will try again.
+    icon.modify(options);
+  }
+  schedule_tooltip_update(tooltip_updater->interval_ms);
+}
+
+void NotifyIconShell::queue_notification(
+    notify_icon_options::notification_options options) {
+  // Still being shown for its minimum interval.
+  if (shown_notification && shown_notification->title == options.title &&
+      shown_notification->text == options.text) {
+    notifications_merged++;
+    return;
+  }
+
+  for (auto& queued : notification_queue) {
+    if (queued.options.title == options.title &&
+        queued.options.text == options.text) {
+      queued.count++;
+      queued.options.priority =
+          std::max(queued.options.priority, options.priority);
+      notifications_merged++;
+      return;
+    }
+  }
+
+  if (notification_queue.size() >= notification_queue_limit) {
+    // Drop the newest of the lowest priority, which may be this one.
+    auto lowest = std::min_element(
+        notification_queue.rbegin(), notification_queue.rend(),
+        [](const queued_notification& a, const queued_notification& b) {
+          return a.options.priority < b.options.priority;
+        });
+    notifications_dropped++;
+    if (lowest == notification_queue.rend() ||
+        options.priority <= lowest->options.priority) {
+      return;
+    }
+    notification_queue.erase(std::next(lowest).base());
+  }
+
+  auto& queued = notification_queue.emplace_back();
+  if (options.icon && options.icon.value()) {
+    queued.icon = CopyIcon(options.icon.value());
+    options.icon = queued.icon.value;
+  }
+  queued.options = std::move(options);
+  notification_queue_depth = notification_queue.size();
+}
+
+void NotifyIconShell::schedule(clock::time_point due) {
+  if (!loop || (timer_due && timer_due.value() <= due)) {
+    return;
+  }
+  timer_due = due;
+  auto delay = std::chrono::ceil<std::chrono::milliseconds>(due - clock::now());
+  loop->set_timer((uint32_t)icon.id.callback_id,
+                  (UINT)std::max<int64_t>(delay.count(), 0),
+                  [self = shared_from_this()] { self->flush(); });
+}
+
+// Shown as e.g. "Title (3)", still fitting in the 64 characters (with the
+// terminator) of NOTIFYICONDATAW::szInfoTitle.
+static void append_notification_count(std::optional<std::wstring>& title,
+                                      uint32_t count) {
+  constexpr size_t max_length = 63;
+  auto suffix = L" ("s + std::to_wstring(count) + L")"s;
+  auto value = title.value_or(std::wstring{});
+  value.resize(bounded_text_length(value, max_length - suffix.size()));
+  title = value + suffix;
+}
+
+// On the message thread, sends the held back updates that are due.
+void NotifyIconShell::flush() {
+  std::lock_guard lock{mutex};
+  timer_due.reset();
+
+  // Removed since.
+  if (!icon.id) {
+    pending_tooltip.reset();
+    notification_queue.clear();
+    notification_queue_depth = 0;
+    return;
+  }
+
+  auto now = clock::now();
+  notify_icon_options options;
+  std::optional<clock::time_point> next_due;
+  auto wait_until = [&](clock::time_point due) {
+    next_due = next_due ? std::min(next_due.value(), due) : due;
+  };
+
+  if (pending_tooltip) {
+    auto due = tooltip_sent_at + tooltip_min_interval.load();
+    if (now < due) {
+      wait_until(due);
+    } else {
+      options.tooltip = std::exchange(pending_tooltip, std::nullopt);
+      tooltip_sent_at = now;
+      tooltips_sent++;
+    }
+  }
+
+  // Must outlive the modify.
+  Unique<HICON, DestroyIcon> notification_icon;
+  if (!notification_queue.empty()) {
+    auto interval = notification_min_interval.load();
+    if (now < notification_sent_at + interval) {
+      wait_until(notification_sent_at + interval);
+    } else {
+      // Highest priority, oldest first.
+      auto it = std::max_element(
+          notification_queue.begin(), notification_queue.end(),
+          [](const queued_notification& a, const queued_notification& b) {
+            return a.options.priority < b.options.priority;
+          });
+      auto queued = std::move(*it);
+      notification_queue.erase(it);
+      notification_queue_depth = notification_queue.size();
+
+      notification_icon = std::move(queued.icon);
+      shown_notification = {queued.options.title, queued.options.text};
+      if (queued.count > 1) {
+        append_notification_count(queued.options.title, queued.count);
+      }
+      options.notification = std::move(queued.options);
+      notification_sent_at = now;
+      notifications_sent++;
+      if (!notification_queue.empty()) {
+        wait_until(now + interval);
+      }
+    }
+  }
+
+  if (next_due) {
+    schedule(next_due.value());
+  }
+  if (options.tooltip || options.notification) {
+    // There's nothing to report an error to, later updates will try again.
+    icon.modify(options);
+  }
+}
+
+// Replaces an icon the notify icon is using, keeping it from being evicted
+// while it's in use.
+static void set_pinned_icon_ref(NapiUnwrappedRef<IconObject>& field,
+                                NapiUnwrappedRef<IconObject> value) {
+  if (value.wrapped) value.wrapped->pins++;
+  if (field.wrapped) field.wrapped->pins--;
+  field = std::move(value);
+}
+
+// Replaces the icon shown in the notification area, letting surfaces know
+// where to publish their commits.
+static void set_shown_icon_ref(NotifyIconObject* this_object,
+                               NapiUnwrappedRef<IconObject> value) {
+  auto& id = this_object->display_id;
+  if (auto old_icon = this_object->icon_ref.wrapped;
+      old_icon && old_icon->surface) {
+    old_icon->surface->remove_display(id);
+  }
+  if (auto new_icon = value.wrapped; new_icon && new_icon->surface) {
+    new_icon->surface->add_display(id, new_icon->surface_version);
+  }
+  set_pinned_icon_ref(this_object->icon_ref, std::move(value));
+}
+
+// Set `trim` unless the caller trims once it has applied options for several
+// icons, which may otherwise evict the icons of the rest.
 void apply_options(NotifyIconObject* this_object,
-                   notify_icon_object_options& options) {
+                   notify_icon_object_options& options, bool trim = true) {
   if (options.icon_ref) {
-    this_object->icon_ref = std::move(options.icon_ref.value());
+    set_shown_icon_ref(this_object, std::move(options.icon_ref.value()));
   }
 
   if (options.select_callback) {
     this_object->select_callback = std::move(options.select_callback.value());
   }
 
+  if (options.tooltip_request_callback) {
+    this_object->tooltip_request_callback =
+        std::move(options.tooltip_request_callback.value());
+    this_object->tooltip_requested_at.reset();
+  }
+  if (options.tooltip_ttl_ms) {
+    this_object->tooltip_ttl =
+        std::chrono::milliseconds{options.tooltip_ttl_ms.value()};
+  }
+
+  if (options.events_callback) {
+    this_object->events_callback = std::move(options.events_callback.value());
+  }
+  if (options.events_available_callback) {
+    this_object->events_available_callback =
+        std::move(options.events_available_callback.value());
+  }
+  if (options.event_mask) {
+    this_object->event_mask = options.event_mask.value();
+  }
+
+  auto& shell = *this_object->shell;
+  shell.event_mask = this_object->events_callback ||
+                             this_object->events_available_callback
+                         ? this_object->event_mask
+                         : 0;
+  if (options.event_buffer_size || options.event_overflow) {
+    std::lock_guard lock{shell.events_mutex};
+    if (options.event_buffer_size) {
+      shell.event_buffer_size = std::max(options.event_buffer_size.value(), 1u);
+    }
+    if (options.event_overflow) {
+      shell.event_overflow = options.event_overflow.value();
+    }
+  }
+  if (options.tooltip_min_interval_ms) {
+    shell.tooltip_min_interval =
+        std::chrono::milliseconds{options.tooltip_min_interval_ms.value()};
+  }
+  if (options.notification_min_interval_ms) {
+    shell.notification_min_interval = std::chrono::milliseconds{
+        options.notification_min_interval_ms.value()};
+  }
+  if (options.notification_queue_limit) {
+    shell.notification_queue_limit = options.notification_queue_limit.value();
+  }
+
   if (options.object_notification) {
     if (options.object_notification->icon_ref) {
-      this_object->notification_icon_ref =
-          std::move(options.object_notification->icon_ref.value());
+      set_pinned_icon_ref(
+          this_object->notification_icon_ref,
+          std::move(options.object_notification->icon_ref.value()));
     } else {  // Since the notification is being replaced, we don't need to keep
               // the old notification icon.
-      this_object->notification_icon_ref.clear();
+      set_pinned_icon_ref(this_object->notification_icon_ref, {});
+    }
+  }
+
+  // Now the new icons are pinned, the old ones may be evicted.
+  if (trim) {
+    get_env_data(this_object->env_)->trim_icons();
+  }
+}
+
+// A shell call made off the JS thread: on the icon's strand by the *Async()
+// methods, or on the message thread by createMany(). Created and destroyed on
+// the JS thread, keeping the icon object and the icons in the options alive
+// until it completes.
+struct async_shell_call {
+  enum kind_t { add, modify, remove };
+
+  napi_env env = nullptr;
+  NotifyIconObject* object = nullptr;
+  kind_t kind = modify;
+  napi_ref object_ref = nullptr;
+  napi_deferred deferred = nullptr;
+  notify_icon_object_options options;
+  // Copies of surface icons in `options`, which make a new handle on each use
+  // and destroy the last, possibly while the call is waiting on the strand.
+  Unique<HICON, DestroyIcon> icon_copy;
+  Unique<HICON, DestroyIcon> notification_icon_copy;
+  // Only for add.
+  notify_icon_id add_id;
+  bool replace = false;
+  DWORD error = 0;
+
+  ~async_shell_call() {
+    if (object_ref) napi_delete_reference(env, object_ref);
+  }
+};
+
+// Passed as the second constructor argument by createAsync() and createMany()
+// to make the shell add later. As an external, it can't be passed from JS.
+struct notify_icon_deferred_add {
+  // For createAsync(), which posts the add to the strand.
+  napi_value* promise = nullptr;
+  // Otherwise, createMany() makes the adds on the message thread.
+  std::vector<std::unique_ptr<async_shell_call>> calls;
+};
+
+// Keeps the icons in `options` from being evicted before the shell has them.
+static void pin_option_icons(notify_icon_object_options& options,
+                             int32_t delta) {
+  if (options.icon_ref && options.icon_ref->wrapped) {
+    options.icon_ref->wrapped->pins += delta;
+  }
+  if (options.object_notification && options.object_notification->icon_ref &&
+      options.object_notification->icon_ref->wrapped) {
+    options.object_notification->icon_ref->wrapped->pins += delta;
+  }
+}
+
+static napi_status complete_shell_call(async_shell_call* call) {
+  auto env = call->env;
+  auto object = call->object;
+  pin_option_icons(call->options, -1);
+  object->pending_shell_calls--;
+
+  // Held back by request_tooltip() until the calls before it were made.
+  if (!object->pending_shell_calls && object->requested_tooltip &&
+      call->kind != async_shell_call::remove) {
+    notify_icon_options options;
+    options.tooltip = std::exchange(object->requested_tooltip, std::nullopt);
+    std::lock_guard lock{object->shell->mutex};
+    // There's nothing to report an error to, the next request will try again.
+    object->shell->modify(std::move(options));
+  }
+
+  if (call->error) {
+    if (call->kind == async_shell_call::add) {
+      get_env_data(env)->remove_icon(call->add_id.callback_id);
+      object->shell->detach();
+    }
+    napi_value error;
+    NAPI_RETURN_IF_NOT_OK(napi_create_win32_error(env, "Shell_NotifyIconW",
+                                                  call->error, &error));
+    return napi_reject_deferred(env, call->deferred, error);
+  }
+
+  napi_value result;
+  NAPI_RETURN_IF_NOT_OK(napi_get_undefined(env, &result));
+  switch (call->kind) {
+    case async_shell_call::add:
+      object->display_id = call->add_id;
+      NAPI_RETURN_IF_NOT_OK(
+          napi_get_reference_value(env, call->object_ref, &result));
+      apply_options(object, call->options);
+      break;
+    case async_shell_call::modify:
+      apply_options(object, call->options);
+      break;
+    case async_shell_call::remove:
+      object->removed(env);
+      break;
+  }
+  return napi_resolve_deferred(env, call->deferred, result);
+}
+
+static void make_shell_call(async_shell_call* call) {
+  auto& shell = *call->object->shell;
+  std::lock_guard lock{shell.mutex};
+  bool ok = true;
+  switch (call->kind) {
+    case async_shell_call::add:
+      if (call->replace) {
+        // Ignore any errors, as in init().
+        delete_notify_icon({nullptr, 0, call->add_id.guid});
+      }
+      ok = shell.add(call->add_id, call->options);
+      break;
+    case async_shell_call::modify:
+      ok = shell.modify(call->options);
+      break;
+    case async_shell_call::remove:
+      ok = shell.icon.clear();
+      break;
+  }
+  if (!ok) {
+    call->error = GetLastError();
+  }
+}
+
+// Runs on the strand, then completes on the JS thread.
+static void run_shell_call(async_shell_call* call) {
+  make_shell_call(call);
+
+  // Held until the call is queued, so the environment can't be destroyed
+  // in between.
+  auto env_data = lock_env_data(call->env);
+  if (!env_data) {
+    // The environment is being torn down, along with everything in the call.
+    return;
+  }
+  // Owned by the lambda, so it's destroyed even if it never runs.
+  env_data->icon_message_loop.post_to_env_thread(
+      [owned_call = std::unique_ptr<async_shell_call>{call}](napi_env env) {
+        NAPI_THROW_RETURN_VOID_IF_NOT_OK(env,
+                                         complete_shell_call(owned_call.get()));
+      },
+      NotifyIconMessageLoop::required);
+}
+
+static napi_status post_shell_call(std::unique_ptr<async_shell_call> call,
+                                   napi_value object_value,
+                                   napi_value* promise) {
+  auto env = call->env;
+  NAPI_RETURN_IF_NOT_OK(napi_create_promise(env, &call->deferred, promise));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_create_reference(env, object_value, 1, &call->object_ref));
+  pin_option_icons(call->options, 1);
+
+  auto& options = call->options;
+  if (options.icon_ref && options.icon_ref->wrapped &&
+      options.icon_ref->wrapped->surface && options.icon) {
+    call->icon_copy = CopyIcon(options.icon.value());
+    options.icon = call->icon_copy.value;
+  }
+  if (options.object_notification && options.object_notification->icon_ref &&
+      options.object_notification->icon_ref->wrapped &&
+      options.object_notification->icon_ref->wrapped->surface &&
+      options.notification && options.notification->icon) {
+    call->notification_icon_copy = CopyIcon(options.notification->icon.value());
+    options.notification->icon = call->notification_icon_copy.value;
+  }
+
+  if (!call->object->strand->post(
+          [call = call.get()] { run_shell_call(call); })) {
+    auto error = GetLastError();
+    pin_option_icons(call->options, -1);
+    if (call->kind == async_shell_call::add) {
+      get_env_data(env)->remove_icon(call->add_id.callback_id);
+      call->object->shell->detach();
     }
+    napi_value error_value;
+    NAPI_RETURN_IF_NOT_OK(napi_create_win32_error(
+        env, "TrySubmitThreadpoolCallback", error, &error_value));
+    return napi_reject_deferred(env, call->deferred, error_value);
   }
+  call->object->pending_shell_calls++;
+  // This one is newer.
+  if (options.tooltip) {
+    call->object->requested_tooltip.reset();
+  }
+  call.release();
+  return napi_ok;
 }
 
 napi_status NotifyIconObject::init(napi_env env, napi_callback_info info,
                                    napi_value* result) {
   env_ = env;
   notify_icon_add_options options;
+  napi_value deferred_add_value;
+  NAPI_RETURN_IF_NOT_OK(napi_get_cb_info(env, info, result, nullptr, 0,
+                                         &options, &deferred_add_value));
+
+  notify_icon_deferred_add* deferred_add = nullptr;
+  napi_valuetype deferred_add_type;
   NAPI_RETURN_IF_NOT_OK(
-      napi_get_cb_info(env, info, result, nullptr, 0, &options));
+      napi_typeof(env, deferred_add_value, &deferred_add_type));
+  if (deferred_add_type == napi_external) {
+    NAPI_RETURN_IF_NOT_OK(napi_get_value_external(
+        env, deferred_add_value, reinterpret_cast<void**>(&deferred_add)));
+  }
 
-  static int last_id = 0;
+  // Shared by every environment, as they share the message window that icon
+  // messages are routed from by id.
+  static std::atomic<int32_t> last_id = 0;
   auto id = ++last_id;
+  // Wrapped around, which would collide with the ids of other icons' timers.
+  if (id <= 0) {
+    napi_throw_range_error(env, nullptr, "Too many notify icons created.");
+    return napi_pending_exception;
+  }
 
   auto env_data = get_env_data(env);
+  shell->loop = &env_data->icon_message_loop;
 
   // Shell_NotifyIcon() fails with "Unspecified error" 0x80004005 if it already
   // exists, including from a previous process that has exited without removing
   // it.
-  if (options.guid && options.replace.value_or(true)) {
+  auto replace = options.guid && options.replace.value_or(true);
+
+  NAPI_RETURN_IF_NOT_OK(env_data->add_icon(id, *result, this));
+  notify_icon_id new_id{env_data->icon_message_loop.hwnd, id, options.guid};
+
+  if (deferred_add) {
+    auto call = std::make_unique<async_shell_call>();
+    call->env = env;
+    call->object = this;
+    call->kind = async_shell_call::add;
+    call->options = std::move(options);
+    call->add_id = new_id;
+    call->replace = replace;
+    if (deferred_add->promise) {
+      return post_shell_call(std::move(call), *result, deferred_add->promise);
+    }
+    // Until createMany() applies the options, once every call is made.
+    pin_option_icons(call->options, 1);
+    deferred_add->calls.push_back(std::move(call));
+    return napi_ok;
+  }
+
+  if (replace) {
     // Ignore any errors, as the same error as described above can happen here.
     delete_notify_icon({nullptr, 0, options.guid.value()});
   }
 
-  NAPI_RETURN_IF_NOT_OK(env_data->add_icon(id, *result, this));
-
-  if (!notify_icon.add({env_data->icon_message_loop.hwnd, id, options.guid},
-                       options, env_data->icon_message_loop.notify_message())) {
-    napi_throw_win32_error(env, "Shell_NotifyIconW");
-    return napi_pending_exception;
+  {
+    std::lock_guard lock{shell->mutex};
+    if (!shell->add(new_id, options)) {
+      napi_throw_win32_error(env, "Shell_NotifyIconW");
+      return napi_pending_exception;
+    }
   }
+  display_id = new_id;
 
   apply_options(this, options);
 
@@ -253,59 +1003,1187 @@ napi_value export_NotifyIcon_id(napi_env env, napi_callback_info info) {
   NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
   napi_value result;
   NAPI_THROW_RETURN_NULL_IF_NOT_OK(
-      env, napi_create(env, this_object->notify_icon.id.callback_id, &result));
+      env, napi_create(env, this_object->display_id.callback_id, &result));
   return result;
 }
 
-napi_value export_NotifyIcon_update(napi_env env, napi_callback_info info) {
-  NotifyIconObject* this_object;
-  notify_icon_object_options options;
-  NAPI_RETURN_NULL_IF_NOT_OK(
-      napi_get_cb_info(env, info, &this_object, nullptr, 1, &options));
+// A surface icon makes a new handle on each use, destroying the last, so one
+// taken when an update was made may be gone by the time it's sent. Replaces
+// them with new handles from the icons `object` was last updated with, which
+// must be sent before any other use of those icons.
+static napi_status refresh_surface_icons(napi_env env, NotifyIconObject* object,
+                                         notify_icon_options* options) {
+  auto icon = object->icon_ref.wrapped;
+  if (icon && icon->surface && options->icon) {
+    NAPI_RETURN_IF_NOT_OK(icon->materialize(env));
+    options->icon = icon->icon;
+  }
+  auto notification_icon = object->notification_icon_ref.wrapped;
+  if (notification_icon && notification_icon->surface &&
+      options->notification && options->notification->icon) {
+    // Don't destroy the handle just taken for the icon.
+    if (notification_icon != icon || !options->icon) {
+      NAPI_RETURN_IF_NOT_OK(notification_icon->materialize(env));
+    }
+    options->notification->icon = notification_icon->icon;
+  }
+  return napi_ok;
+}
 
-  if (!this_object->notify_icon.modify(options)) {
-    napi_throw_win32_error(env, "Shell_NotifyIconW");
-    return nullptr;
+// Sends the merged updates of every icon in the batch, throwing the first
+// error after trying all of them.
+static napi_status flush_batch(napi_env env, EnvData* env_data) {
+  auto batched = std::move(env_data->batched_notify_icons);
+  env_data->batched_notify_icons.clear();
+
+  DWORD error = 0;
+  bool pending_error = false;
+  for (auto& ref : batched) {
+    napi_value value;
+    NAPI_RETURN_IF_NOT_OK(ref.get(&value));
+    NotifyIconObject* object;
+    NAPI_RETURN_IF_NOT_OK(napi_get_value(env, value, &object));
+
+    auto options = std::exchange(object->batched_options, std::nullopt);
+    // Could have been removed since.
+    if (!options || !object->display_id) {
+      continue;
+    }
+    // Can't happen, as they're rejected while the icon is batched, but would
+    // race the batch.
+    if (object->pending_shell_calls) {
+      pending_error = true;
+      continue;
+    }
+    NAPI_RETURN_IF_NOT_OK(refresh_surface_icons(env, object, &options.value()));
+    env_data->notify_icon_modify_count++;
+    std::lock_guard lock{object->shell->mutex};
+    if (!object->shell->modify(options.value()) && !error) {
+      error = GetLastError();
+    }
   }
-  apply_options(this_object, options);
 
-  return nullptr;
+  if (error) {
+    napi_throw_win32_error(env, "Shell_NotifyIconW", error);
+    return napi_pending_exception;
+  }
+  if (pending_error) {
+    napi_throw_error(env, nullptr,
+                     "Wait for pending *Async() calls on this icon first.");
+    return napi_pending_exception;
+  }
+  return napi_ok;
 }
 
-napi_value export_NotifyIcon_remove(napi_env env, napi_callback_info info) {
-  NotifyIconObject* this_object;
-  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
-  NAPI_RETURN_NULL_IF_NOT_OK(this_object->remove(env));
+static napi_value auto_batch_flush(napi_env env, napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  env_data->auto_batch_scheduled = false;
+  // An explicit batch is still open, it will flush when it ends.
+  if (env_data->batch_depth) {
+    return nullptr;
+  }
+  NAPI_RETURN_NULL_IF_NOT_OK(flush_batch(env, env_data));
   return nullptr;
 }
 
-napi_status NotifyIconObject::define_class(EnvData* env_data,
-                                           napi_value* constructor_value) {
-  return NapiWrapped::define_class(
-      env_data->env, "NotifyIcon", constructor_value,
-      &env_data->notify_icon_constructor,
-      {
-          napi_getter_property("id", export_NotifyIcon_id),
-          napi_method_property("update", export_NotifyIcon_update),
-          napi_method_property("remove", export_NotifyIcon_remove),
-      });
+static napi_status schedule_auto_batch_flush(napi_env env) {
+  napi_value global, queue_microtask, flush;
+  NAPI_RETURN_IF_NOT_OK(napi_get_global(env, &global));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, global, "queueMicrotask",
+                                                &queue_microtask));
+  NAPI_RETURN_IF_NOT_OK(napi_create_function(env, "flushNotifyIconBatch",
+                                             NAPI_AUTO_LENGTH,
+                                             auto_batch_flush, nullptr, &flush));
+  return napi_call_function(env, global, queue_microtask, 1, &flush, nullptr);
 }
 
-napi_status NotifyIconObject::remove(napi_env env) {
-  if (!notify_icon.id) {
-    return napi_ok;
+// Direct shell calls aren't ordered with those on the strand, so could be
+// overwritten by an earlier *Async() call. Batches are only opened for icons
+// without any, and no more can be made until they're flushed, see
+// throw_if_batched().
+static napi_status throw_if_pending_shell_calls(napi_env env,
+                                                NotifyIconObject* object) {
+  if (object->pending_shell_calls) {
+    napi_throw_error(env, nullptr,
+                     "Wait for pending *Async() calls on this icon first.");
+    return napi_pending_exception;
   }
+  return napi_ok;
+}
 
-  auto env_data = get_env_data(env);
-
-  auto id = notify_icon.id.callback_id;
-
-  if (!notify_icon.clear()) {
-    napi_throw_win32_error(env, "Shell_NotifyIconW");
+// *Async() calls aren't ordered with the batch flush, so could be overwritten by
+// the updates batched before them.
+static napi_status throw_if_batched(napi_env env, NotifyIconObject* object) {
+  if (object->batched_options) {
+    napi_throw_error(env, nullptr,
+                     "End the batch with updates to this icon first.");
     return napi_pending_exception;
   }
+  return napi_ok;
+}
+
+napi_value export_NotifyIcon_update(napi_env env, napi_callback_info info) {
+  napi_value this_value;
+  notify_icon_object_options options;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_value, nullptr, 1, &options));
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, this_value, &this_object));
+  NAPI_RETURN_NULL_IF_NOT_OK(throw_if_pending_shell_calls(env, this_object));
+
+  auto env_data = get_env_data(env);
+  env_data->notify_icon_update_count++;
+
+  if (!env_data->batch_depth && env_data->auto_batch &&
+      !env_data->auto_batch_scheduled) {
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, schedule_auto_batch_flush(env));
+    env_data->auto_batch_scheduled = true;
+  }
+
+  if (env_data->batch_depth || env_data->auto_batch_scheduled) {
+    if (!this_object->batched_options) {
+      NapiRef ref;
+      NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, ref.create(env, this_value));
+      env_data->batched_notify_icons.push_back(std::move(ref));
+      this_object->batched_options.emplace();
+    }
+    merge_notify_icon_options(&this_object->batched_options.value(), options);
+    apply_options(this_object, options);
+    return nullptr;
+  }
+
+  env_data->notify_icon_modify_count++;
+  {
+    std::lock_guard lock{this_object->shell->mutex};
+    if (!this_object->shell->modify(options)) {
+      napi_throw_win32_error(env, "Shell_NotifyIconW");
+      return nullptr;
+    }
+  }
+  apply_options(this_object, options);
+
+  return nullptr;
+}
+
+static void pin_state_icon(NotifyIconObject::state& state, int32_t delta) {
+  if (state.icon_ref && state.icon_ref->wrapped) {
+    state.icon_ref->wrapped->pins += delta;
+  }
+}
+
+// Adds or replaces each state given. All are validated before any are
+// replaced.
+napi_value export_NotifyIcon_defineStates(napi_env env,
+                                          napi_callback_info info) {
+  napi_value this_value, states_value;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_cb_info(env, info, &this_value, nullptr,
+                                              1, &states_value));
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, this_value, &this_object));
+
+  napi_value names;
+  uint32_t count;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_get_property_names(env, states_value, &names));
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(env,
+                                   napi_get_array_length(env, names, &count));
+
+  std::vector<std::pair<std::string, NotifyIconObject::state>> states;
+  for (uint32_t i = 0; i != count; i++) {
+    napi_value name_value, options_value;
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+        env, napi_get_element(env, names, i, &name_value));
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+        env, napi_get_property(env, states_value, name_value, &options_value));
+    std::string name;
+    NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, name_value, &name));
+    notify_icon_object_options options;
+    NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, options_value, &options));
+
+    if (options.notification) {
+      napi_throw_type_error(
+          env, nullptr,
+          ("State \""s + name + "\" can't include a notification."s).c_str());
+      return nullptr;
+    }
+    // The prepared modify keeps the handle, but a surface icon makes a new one
+    // on each use, destroying the last.
+    if (options.icon_ref && options.icon_ref->wrapped &&
+        options.icon_ref->wrapped->surface) {
+      napi_throw_type_error(
+          env, nullptr,
+          ("State \""s + name + "\" can't use a surface icon."s).c_str());
+      return nullptr;
+    }
+
+    auto& state = states.emplace_back(std::move(name), NotifyIconObject::state{})
+                      .second;
+    state.icon_ref = std::move(options.icon_ref);
+    prepare_modify_notify_icon(this_object->display_id, options, &state.modify);
+  }
+
+  for (auto& [name, state] : states) {
+    pin_state_icon(state, 1);
+    auto& defined = this_object->states[name];
+    pin_state_icon(defined, -1);
+    defined = std::move(state);
+  }
+  get_env_data(env)->trim_icons();
+  return nullptr;
+}
+
+napi_value export_NotifyIcon_setState(napi_env env, napi_callback_info info) {
+  NotifyIconObject* this_object;
+  std::string name;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_object, nullptr, 1, &name));
+
+  auto it = this_object->states.find(name);
+  if (it == this_object->states.end()) {
+    napi_throw_range_error(
+        env, nullptr, ("Unknown state \""s + name + "\"."s).c_str());
+    return nullptr;
+  }
+  auto& state = it->second;
+  NAPI_RETURN_NULL_IF_NOT_OK(throw_if_pending_shell_calls(env, this_object));
+
+  // Merged so the flush doesn't overwrite it with the updates batched before.
+  if (this_object->batched_options) {
+    merge_notify_icon_options(&this_object->batched_options.value(),
+                              state.modify.options);
+  } else {
+    std::lock_guard lock{this_object->shell->mutex};
+    if (!this_object->shell->modify(state.modify)) {
+      napi_throw_win32_error(env, "Shell_NotifyIconW");
+      return nullptr;
+    }
+  }
+
+  if (state.icon_ref) {
+    set_shown_icon_ref(this_object, state.icon_ref.value());
+    get_env_data(env)->trim_icons();
+  }
+  return nullptr;
+}
+
+static napi_status get_tooltip_updater_source(
+    napi_env env, napi_value value, TooltipUpdater::source* source,
+    std::vector<NapiRef>* arrays) {
+  napi_value array;
+  napi_valuetype array_type;
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "array", &array));
+  NAPI_RETURN_IF_NOT_OK(napi_typeof(env, array, &array_type));
+
+  if (array_type != napi_undefined) {
+    uint32_t index = 0;
+    NAPI_RETURN_IF_NOT_OK(
+        napi_get_named_property(env, value, "index", &index));
+
+    bool is_typedarray;
+    NAPI_RETURN_IF_NOT_OK(napi_is_typedarray(env, array, &is_typedarray));
+    napi_typedarray_type type = napi_int8_array;
+    size_t length = 0;
+    void* data = nullptr;
+    napi_value buffer = nullptr;
+    bool is_arraybuffer = false;
+    if (is_typedarray) {
+      NAPI_RETURN_IF_NOT_OK(napi_get_typedarray_info(
+          env, array, &type, &length, &data, &buffer, nullptr));
+      NAPI_RETURN_IF_NOT_OK(napi_is_arraybuffer(env, buffer, &is_arraybuffer));
+    }
+
+    size_t element_size = 4;
+    switch (type) {
+      default:
+        napi_throw_type_error(env, nullptr,
+                              "Expected Int32Array, Uint32Array, Float32Array "
+                              "or Float64Array");
+        return napi_pending_exception;
+      case napi_int32_array:
+        source->type = TooltipUpdater::value_type::int32;
+        break;
+      case napi_uint32_array:
+        source->type = TooltipUpdater::value_type::uint32;
+        break;
+      case napi_float32_array:
+        source->type = TooltipUpdater::value_type::float32;
+        break;
+      case napi_float64_array:
+        source->type = TooltipUpdater::value_type::float64;
+        element_size = 8;
+        break;
+    }
+    // Only a SharedArrayBuffer can't be detached while it's being read.
+    if (is_arraybuffer) {
+      napi_throw_type_error(env, nullptr,
+                            "Expected an array over a SharedArrayBuffer");
+      return napi_pending_exception;
+    }
+    if (index >= length) {
+      napi_throw_range_error(env, nullptr, "index is outside the array.");
+      return napi_pending_exception;
+    }
+
+    source->data = static_cast<const uint8_t*>(data) + index * element_size;
+    NAPI_RETURN_IF_NOT_OK(arrays->emplace_back().create(env, array));
+    return napi_ok;
+  }
+
+  std::wstring path;
+  double offset = 0;
+  std::optional<std::string> type_name;
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "file", &path));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "byteOffset", &offset));
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "type", &type_name));
+
+  size_t size = 4;
+  auto type = type_name.value_or("int32");
+  if (type == "int32") {
+    source->type = TooltipUpdater::value_type::int32;
+  } else if (type == "uint32") {
+    source->type = TooltipUpdater::value_type::uint32;
+  } else if (type == "float32") {
+    source->type = TooltipUpdater::value_type::float32;
+  } else if (type == "float64") {
+    source->type = TooltipUpdater::value_type::float64;
+    size = 8;
+  } else {
+    napi_throw_type_error(
+        env, nullptr,
+        "type must be \"int32\", \"uint32\", \"float32\" or \"float64\".");
+    return napi_pending_exception;
+  }
+  if (offset < 0 || offset != (double)(uint64_t)offset) {
+    napi_throw_range_error(env, nullptr,
+                           "byteOffset must be a non-negative integer.");
+    return napi_pending_exception;
+  }
+
+  if (auto error =
+          map_tooltip_source_file(path, (uint64_t)offset, size, source)) {
+    napi_throw_win32_error(env, error.syscall, error.code);
+    return napi_pending_exception;
+  }
+  return napi_ok;
+}
+
+static napi_status get_tooltip_updater(napi_env env, napi_value value,
+                                       TooltipUpdater* updater,
+                                       std::vector<NapiRef>* arrays) {
+  std::wstring text;
+  napi_value sources;
+  std::optional<uint32_t> interval_ms;
+  NAPI_RETURN_IF_NOT_OK(napi_get_named_property(env, value, "template", &text));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "sources", &sources));
+  NAPI_RETURN_IF_NOT_OK(
+      napi_get_named_property(env, value, "intervalMs", &interval_ms));
+  updater->interval_ms =
+      std::max<uint32_t>(interval_ms.value_or(1000), USER_TIMER_MINIMUM);
+
+  uint32_t count;
+  NAPI_RETURN_IF_NOT_OK(napi_get_array_length(env, sources, &count));
+  for (uint32_t i = 0; i != count; i++) {
+    napi_value source;
+    NAPI_RETURN_IF_NOT_OK(napi_get_element(env, sources, i, &source));
+    NAPI_RETURN_IF_NOT_OK(get_tooltip_updater_source(
+        env, source, &updater->sources.emplace_back(), arrays));
+  }
+
+  if (!updater->parse_template(text)) {
+    napi_throw_type_error(env, nullptr,
+                          "Invalid template: expected \"{index}\" or "
+                          "\"{index:.precision}\" for each source.");
+    return napi_pending_exception;
+  }
+  return napi_ok;
+}
+
+// Replaces the tooltip updater, or removes it if given null.
+napi_value export_NotifyIcon_setTooltipUpdater(napi_env env,
+                                               napi_callback_info info) {
+  napi_value this_value, options;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_value, nullptr, 1, &options));
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, this_value, &this_object));
+
+  napi_valuetype type;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, napi_typeof(env, options, &type));
+  std::unique_ptr<TooltipUpdater> updater;
+  std::vector<NapiRef> arrays;
+  if (type != napi_undefined && type != napi_null) {
+    updater = std::make_unique<TooltipUpdater>();
+    NAPI_RETURN_NULL_IF_NOT_OK(
+        get_tooltip_updater(env, options, updater.get(), &arrays));
+  }
+
+  {
+    std::lock_guard lock{this_object->shell->mutex};
+    this_object->shell->set_tooltip_updater(std::move(updater));
+  }
+  // The previous arrays are no longer being read.
+  this_object->tooltip_updater_arrays = std::move(arrays);
+  return nullptr;
+}
+
+static void clear_command_ring(NotifyIconObject* this_object) {
+  if (this_object->command_ring) {
+    release_command_ring(this_object->command_ring->id);
+    this_object->command_ring = nullptr;
+  }
+  // The ring is closed, so these are no longer used.
+  this_object->command_ring_array = {};
+  for (auto& state : this_object->command_ring_states) {
+    pin_state_icon(state, -1);
+  }
+  this_object->command_ring_states.clear();
+}
+
+// Replaces the command ring applied to this icon, returning its id, or
+// removes it if `slots` is null.
+napi_value export_NotifyIcon_setCommandRing(napi_env env,
+                                            napi_callback_info info) {
+  NotifyIconObject* this_object;
+  napi_value slots;
+  std::optional<std::vector<std::string>> state_names;
+  std::optional<std::vector<std::wstring>> tooltips;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_cb_info(env, info, &this_object, nullptr,
+                                              1, &slots, &state_names,
+                                              &tooltips));
+  if (!state_names) state_names.emplace();
+  if (!tooltips) tooltips.emplace();
+
+  napi_valuetype type;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, napi_typeof(env, slots, &type));
+  if (type == napi_undefined || type == napi_null) {
+    clear_command_ring(this_object);
+    get_env_data(env)->trim_icons();
+    return nullptr;
+  }
+
+  if (!this_object->display_id) {
+    napi_throw_error(env, nullptr, "Icon has been removed.");
+    return nullptr;
+  }
+
+  bool is_typedarray;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_is_typedarray(env, slots, &is_typedarray));
+  napi_typedarray_type array_type = napi_int8_array;
+  size_t length = 0;
+  void* data = nullptr;
+  napi_value buffer = nullptr;
+  bool is_arraybuffer = false;
+  if (is_typedarray) {
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+        env, napi_get_typedarray_info(env, slots, &array_type, &length, &data,
+                                      &buffer, nullptr));
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+        env, napi_is_arraybuffer(env, buffer, &is_arraybuffer));
+  }
+  auto capacity = length - command_ring_header_size;
+  if (array_type != napi_int32_array || length <= command_ring_header_size ||
+      capacity > 0x10000000 || (capacity & (capacity - 1))) {
+    napi_throw_type_error(env, nullptr,
+                          "Expected an Int32Array with a power of two number "
+                          "of slots after the header.");
+    return nullptr;
+  }
+  // The message thread writes to it, which an ArrayBuffer being detached
+  // would make a use after free.
+  if (is_arraybuffer) {
+    napi_throw_type_error(env, nullptr,
+                          "Expected an Int32Array over a SharedArrayBuffer");
+    return nullptr;
+  }
+  if (state_names->size() > command_ring_max_choices ||
+      tooltips->size() > command_ring_max_choices) {
+    napi_throw_range_error(env, nullptr, "Too many states or tooltips.");
+    return nullptr;
+  }
+
+  std::vector<NotifyIconObject::state> states;
+  std::vector<notify_icon_prepared_modify> modifies;
+  for (auto& name : state_names.value()) {
+    auto it = this_object->states.find(name);
+    if (it == this_object->states.end()) {
+      napi_throw_range_error(
+          env, nullptr, ("Unknown state \""s + name + "\"."s).c_str());
+      return nullptr;
+    }
+    states.push_back(it->second);
+    modifies.push_back(it->second.modify);
+  }
+
+  NapiRef array_ref;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, array_ref.create(env, slots));
+
+  for (auto& state : states) {
+    pin_state_icon(state, 1);
+  }
+  clear_command_ring(this_object);
+  this_object->command_ring = create_command_ring(
+      this_object->display_id.callback_hwnd, this_object->shell,
+      static_cast<int32_t*>(data), (uint32_t)capacity, std::move(modifies),
+      std::move(tooltips.value()));
+  this_object->command_ring_array = std::move(array_ref);
+  this_object->command_ring_states = std::move(states);
+  get_env_data(env)->trim_icons();
+
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create(env, this_object->command_ring->id, &result));
+  return result;
+}
+
+// Can be called from any environment, e.g. a worker, as rings are
+// process-wide. Returns false if the ring has been released.
+napi_value export_NotifyIcon_wakeCommandRing(napi_env env,
+                                             napi_callback_info info) {
+  int32_t id;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &id));
+
+  auto ring = find_command_ring(id);
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_get_boolean(env, ring && ring->wake(), &result));
+  return result;
+}
+
+napi_value export_NotifyIcon_commandRingStats(napi_env env,
+                                              napi_callback_info info) {
+  int32_t id;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &id));
+
+  auto ring = find_command_ring(id);
+  if (!ring) {
+    return nullptr;
+  }
+  auto stats = ring->get_stats();
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env,
+      napi_create_object(
+          env, &result,
+          {
+              {"applied", (double)stats.applied},
+              {"wakes", (double)stats.wakes},
+              {"drains", (double)stats.drains},
+              {"meanLatencyUs",
+               stats.drains ? (double)stats.total_latency.count() / stats.drains
+                            : 0.0},
+              {"maxLatencyUs", (double)stats.max_latency.count()},
+          }));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_eventStats(napi_env env,
+                                            napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  std::lock_guard lock{env_data->events_mutex};
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(
+               env, &result,
+               {
+                   {"delivered", (double)env_data->delivered_event_count},
+                   {"merged", (double)env_data->merged_event_count},
+                   {"dropped", (double)env_data->dropped_event_count},
+                   {"batches", (double)env_data->event_batch_count},
+               }));
+  return result;
+}
+
+// Takes up to `max` waiting events from the shell as an array of JS objects.
+static napi_status take_events(napi_env env, NotifyIconObject* object,
+                               size_t max, napi_value* result) {
+  auto events = object->shell->take_events(max);
+  {
+    auto env_data = get_env_data(env);
+    std::lock_guard lock{env_data->events_mutex};
+    env_data->delivered_event_count += events.size();
+  }
+
+  NAPI_RETURN_IF_NOT_OK(
+      napi_create_array_with_length(env, events.size(), result));
+  for (uint32_t index = 0; index != events.size(); index++) {
+    auto& args = events[index];
+    napi_value event;
+    NAPI_RETURN_IF_NOT_OK(
+        napi_create_object(env, &event,
+                           {
+                               {"type", notify_icon_event_name(args.type)},
+                               {"mouseX", args.mouse_x},
+                               {"mouseY", args.mouse_y},
+                           }));
+    if (args.type == notify_icon_event_select) {
+      NAPI_RETURN_IF_NOT_OK(napi_set_named_property(env, event, "rightButton",
+                                                    args.right_button));
+    }
+    NAPI_RETURN_IF_NOT_OK(napi_set_element(env, *result, index, event));
+  }
+  return napi_ok;
+}
+
+napi_status NotifyIconObject::events_woken(napi_env env,
+                                          napi_value this_value) {
+  if (events_callback) {
+    napi_value events;
+    NAPI_RETURN_IF_NOT_OK(take_events(env, this, SIZE_MAX, &events));
+    events_callback(this_value, {events});
+  } else if (events_available_callback) {
+    events_available_callback(this_value, {});
+  } else {
+    // Unsubscribed since.
+    shell->take_events(SIZE_MAX);
+  }
+  return napi_ok;
+}
+
+napi_value export_NotifyIcon_takeEvents(napi_env env,
+                                        napi_callback_info info) {
+  NotifyIconObject* this_object;
+  std::optional<uint32_t> max;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_object, nullptr, 0, &max));
+
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, take_events(env, this_object, max.value_or(UINT32_MAX), &result));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_eventBufferStats(napi_env env,
+                                                  napi_callback_info info) {
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
+  auto& shell = *this_object->shell;
+  size_t queued;
+  {
+    std::lock_guard lock{shell.events_mutex};
+    queued = shell.events.size();
+  }
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(env, &result,
+                              {
+                                  {"queued", (double)queued},
+                                  {"dropped", (double)shell.events_dropped},
+                              }));
+  return result;
+}
+
+napi_value export_NotifyIcon_createAsync(napi_env env,
+                                         napi_callback_info info) {
+  napi_value options;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_args(env, info, 0, &options));
+
+  napi_value promise = nullptr;
+  notify_icon_deferred_add deferred_add;
+  deferred_add.promise = &promise;
+  napi_value deferred_add_value;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_external(env, &deferred_add, nullptr, nullptr,
+                                &deferred_add_value));
+
+  napi_value result;
+  NAPI_RETURN_NULL_IF_NOT_OK(NotifyIconObject::new_instance(
+      env, get_env_data(env)->notify_icon_constructor, &result,
+      {options, deferred_add_value}));
+  return promise;
+}
+
+// Creates the icons with one pass over the options, then adds them all on the
+// message thread, rather than making a round trip per icon. All or nothing: if
+// any add fails, the others are removed before throwing.
+napi_value export_NotifyIcon_createMany(napi_env env,
+                                        napi_callback_info info) {
+  napi_value options_array;
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_required_args(env, info, &options_array));
+  uint32_t length;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_get_array_length(env, options_array, &length));
+
+  auto env_data = get_env_data(env);
+  notify_icon_deferred_add deferred_add;
+  napi_value deferred_add_value, result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_external(env, &deferred_add, nullptr, nullptr,
+                                &deferred_add_value));
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_array_with_length(env, length, &result));
+
+  auto unregister_all = [&] {
+    for (auto& call : deferred_add.calls) {
+      pin_option_icons(call->options, -1);
+      call->object->shell->detach();
+      env_data->remove_icon(call->add_id.callback_id);
+    }
+    env_data->trim_icons();
+  };
+
+  for (uint32_t i = 0; i != length; i++) {
+    napi_value options, object;
+    auto status = napi_get_element(env, options_array, i, &options);
+    if (status == napi_ok) {
+      status = NotifyIconObject::new_instance(
+          env, env_data->notify_icon_constructor, &object,
+          {options, deferred_add_value});
+    }
+    if (status == napi_ok) {
+      status = napi_set_element(env, result, i, object);
+    }
+    if (status != napi_ok) {
+      unregister_all();
+      NAPI_THROW_RETURN_NULL_IF_NOT_OK(env, status);
+    }
+  }
+
+  if (deferred_add.calls.empty()) {
+    return result;
+  }
+
+  env_data->icon_message_loop.run_on_msg_thread_blocking([&] {
+    for (auto& call : deferred_add.calls) {
+      make_shell_call(call.get());
+    }
+  });
+
+  DWORD error = 0;
+  for (auto& call : deferred_add.calls) {
+    if (call->error && !error) {
+      error = call->error;
+    }
+  }
+
+  if (error) {
+    for (auto& call : deferred_add.calls) {
+      if (!call->error) {
+        std::lock_guard lock{call->object->shell->mutex};
+        call->object->shell->icon.clear();
+      }
+    }
+    unregister_all();
+    napi_throw_win32_error(env, "Shell_NotifyIconW", error);
+    return nullptr;
+  }
+
+  // Each apply pins its icons, so nothing is trimmed until they all have.
+  for (auto& call : deferred_add.calls) {
+    pin_option_icons(call->options, -1);
+    call->object->display_id = call->add_id;
+    apply_options(call->object, call->options, false);
+  }
+  env_data->trim_icons();
+  return result;
+}
+
+// Removes the icons given, or every icon if not, with the shell calls made
+// together on the message thread. Throws the first error after trying all of
+// them.
+napi_value export_NotifyIcon_removeAll(napi_env env, napi_callback_info info) {
+  napi_value icons_value;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_args(env, info, 0, &icons_value));
+  napi_valuetype icons_type;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(env,
+                                   napi_typeof(env, icons_value, &icons_type));
+
+  auto env_data = get_env_data(env);
+  std::vector<NotifyIconObject*> objects;
+  auto add_object = [&](napi_value value) -> napi_status {
+    NotifyIconObject* object;
+    NAPI_RETURN_IF_NOT_OK(napi_get_value(env, value, &object));
+    if (object->display_id) {
+      objects.push_back(object);
+    }
+    return napi_ok;
+  };
+
+  if (icons_type == napi_undefined || icons_type == napi_null) {
+    for (auto& [id, icon] : env_data->icons) {
+      napi_value value;
+      NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+          env, napi_get_reference_value(env, icon.ref, &value));
+      NAPI_RETURN_NULL_IF_NOT_OK(add_object(value));
+    }
+  } else {
+    uint32_t length;
+    NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+        env, napi_get_array_length(env, icons_value, &length));
+    for (uint32_t i = 0; i != length; i++) {
+      napi_value value;
+      NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+          env, napi_get_element(env, icons_value, i, &value));
+      NAPI_RETURN_NULL_IF_NOT_OK(add_object(value));
+    }
+  }
+
+  if (objects.empty()) {
+    return nullptr;
+  }
+
+  std::vector<DWORD> errors(objects.size());
+  env_data->icon_message_loop.run_on_msg_thread_blocking([&] {
+    for (size_t i = 0; i != objects.size(); i++) {
+      auto& shell = *objects[i]->shell;
+      std::lock_guard lock{shell.mutex};
+      if (!shell.icon.clear()) {
+        errors[i] = GetLastError();
+      }
+    }
+  });
+
+  DWORD error = 0;
+  for (size_t i = 0; i != objects.size(); i++) {
+    if (errors[i]) {
+      if (!error) error = errors[i];
+    } else {
+      objects[i]->removed(env);
+    }
+  }
+
+  if (error) {
+    napi_throw_win32_error(env, "Shell_NotifyIconW", error);
+  }
+  return nullptr;
+}
+
+// Unlike update(), not merged into any open batch.
+napi_value export_NotifyIcon_updateAsync(napi_env env,
+                                         napi_callback_info info) {
+  napi_value this_value;
+  auto call = std::make_unique<async_shell_call>();
+  NAPI_RETURN_NULL_IF_NOT_OK(
+      napi_get_cb_info(env, info, &this_value, nullptr, 1, &call->options));
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, this_value, &call->object));
+  NAPI_RETURN_NULL_IF_NOT_OK(throw_if_batched(env, call->object));
+  call->env = env;
+  call->kind = async_shell_call::modify;
+
+  auto env_data = get_env_data(env);
+  env_data->notify_icon_update_count++;
+  env_data->notify_icon_modify_count++;
+
+  napi_value promise;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, post_shell_call(std::move(call), this_value, &promise));
+  return promise;
+}
 
-  env_data->remove_icon(id);
+napi_value export_NotifyIcon_removeAsync(napi_env env,
+                                         napi_callback_info info) {
+  napi_value this_value;
+  auto call = std::make_unique<async_shell_call>();
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_cb_info(env, info, nullptr, nullptr,
+                                              &this_value, nullptr));
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_value(env, this_value, &call->object));
+  NAPI_RETURN_NULL_IF_NOT_OK(throw_if_batched(env, call->object));
+  call->env = env;
+  call->kind = async_shell_call::remove;
+
+  napi_value promise;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, post_shell_call(std::move(call), this_value, &promise));
+  return promise;
+}
+
+napi_value export_NotifyIcon_beginBatch(napi_env env,
+                                        napi_callback_info info) {
+  get_env_data(env)->batch_depth++;
+  return nullptr;
+}
 
+napi_value export_NotifyIcon_endBatch(napi_env env, napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  if (!env_data->batch_depth) {
+    napi_throw_error(env, nullptr, "endBatch() called without beginBatch().");
+    return nullptr;
+  }
+  if (--env_data->batch_depth) {
+    return nullptr;
+  }
+  NAPI_RETURN_NULL_IF_NOT_OK(flush_batch(env, env_data));
+  return nullptr;
+}
+
+napi_value export_NotifyIcon_get_autoBatch(napi_env env,
+                                           napi_callback_info info) {
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create(env, get_env_data(env)->auto_batch, &result));
+  return result;
+}
+
+napi_value export_NotifyIcon_set_autoBatch(napi_env env,
+                                           napi_callback_info info) {
+  bool value;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &value));
+  get_env_data(env)->auto_batch = value;
+  return nullptr;
+}
+
+napi_value export_NotifyIcon_get_dispatchQueueLimit(napi_env env,
+                                                    napi_callback_info info) {
+  auto& loop = get_env_data(env)->icon_message_loop;
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create(env, loop.env_queue_limit.load(), &result));
+  return result;
+}
+
+napi_value export_NotifyIcon_set_dispatchQueueLimit(napi_env env,
+                                                    napi_callback_info info) {
+  uint32_t value;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_required_args(env, info, &value));
+  get_env_data(env)->icon_message_loop.env_queue_limit = value;
+  return nullptr;
+}
+
+napi_value export_NotifyIcon_get_dispatchStats(napi_env env,
+                                               napi_callback_info info) {
+  auto stats = get_env_data(env)->icon_message_loop.get_env_queue_stats();
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(env, &result,
+                              {
+                                  {"depth", (double)stats.depth},
+                                  {"highWater", (double)stats.high_water},
+                                  {"dropped", (double)stats.dropped},
+                                  {"batches", (double)stats.batches},
+                              }));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_modifyStats(napi_env env,
+                                             napi_callback_info info) {
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(
+               env, &result,
+               {
+                   {"sent", (double)notify_icon_stats.sent.load()},
+                   {"skipped", (double)notify_icon_stats.skipped.load()},
+               }));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_tooltipStats(napi_env env,
+                                              napi_callback_info info) {
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
+  auto& shell = *this_object->shell;
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(
+               env, &result,
+               {
+                   {"sent", (double)shell.tooltips_sent.load()},
+                   {"dropped", (double)shell.tooltips_dropped.load()},
+                   {"requested", (double)this_object->tooltip_request_count},
+                   {"updated", (double)shell.tooltip_updater_sent.load()},
+               }));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_notificationStats(napi_env env,
+                                                   napi_callback_info info) {
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
+  auto& shell = *this_object->shell;
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env,
+      napi_create_object(
+          env, &result,
+          {
+              {"queued", (double)shell.notification_queue_depth.load()},
+              {"sent", (double)shell.notifications_sent.load()},
+              {"merged", (double)shell.notifications_merged.load()},
+              {"dropped", (double)shell.notifications_dropped.load()},
+          }));
+  return result;
+}
+
+napi_value export_NotifyIcon_get_batchStats(napi_env env,
+                                            napi_callback_info info) {
+  auto env_data = get_env_data(env);
+  auto updates = env_data->notify_icon_update_count;
+  auto modifies = env_data->notify_icon_modify_count;
+  napi_value result;
+  NAPI_THROW_RETURN_NULL_IF_NOT_OK(
+      env, napi_create_object(env, &result,
+                              {
+                                  {"updates", (double)updates},
+                                  {"shellCalls", (double)modifies},
+                                  {"saved", (double)(updates - modifies)},
+                              }));
+  return result;
+}
+
+napi_value export_NotifyIcon_remove(napi_env env, napi_callback_info info) {
+  NotifyIconObject* this_object;
+  NAPI_RETURN_NULL_IF_NOT_OK(napi_get_this_arg(env, info, &this_object));
+  NAPI_RETURN_NULL_IF_NOT_OK(this_object->remove(env));
+  return nullptr;
+}
+
+napi_status NotifyIconObject::define_class(EnvData* env_data,
+                                           napi_value* constructor_value) {
+  return NapiWrapped::define_class(
+      env_data->env, "NotifyIcon", constructor_value,
+      &env_data->notify_icon_constructor,
+      {
+          napi_getter_property("id", export_NotifyIcon_id),
+          napi_getter_property("tooltipStats",
+                               export_NotifyIcon_get_tooltipStats),
+          napi_getter_property("notificationStats",
+                               export_NotifyIcon_get_notificationStats),
+          napi_method_property("update", export_NotifyIcon_update),
+          napi_method_property("remove", export_NotifyIcon_remove),
+          napi_method_property("updateAsync", export_NotifyIcon_updateAsync),
+          napi_method_property("removeAsync", export_NotifyIcon_removeAsync),
+          napi_method_property("defineStates", export_NotifyIcon_defineStates),
+          napi_method_property("setState", export_NotifyIcon_setState),
+          napi_method_property("setTooltipUpdater",
+                               export_NotifyIcon_setTooltipUpdater),
+          napi_method_property("setCommandRing",
+                               export_NotifyIcon_setCommandRing),
+          napi_method_property("takeEvents", export_NotifyIcon_takeEvents),
+          napi_getter_property("eventBufferStats",
+                               export_NotifyIcon_get_eventBufferStats),
+          napi_method_property("wakeCommandRing",
+                               export_NotifyIcon_wakeCommandRing, napi_static),
+          napi_method_property("commandRingStats",
+                               export_NotifyIcon_commandRingStats, napi_static),
+          napi_method_property("createAsync", export_NotifyIcon_createAsync,
+                               napi_static),
+          napi_method_property("createMany", export_NotifyIcon_createMany,
+                               napi_static),
+          napi_method_property("removeAll", export_NotifyIcon_removeAll,
+                               napi_static),
+          napi_method_property("beginBatch", export_NotifyIcon_beginBatch,
+                               napi_static),
+          napi_method_property("endBatch", export_NotifyIcon_endBatch,
+                               napi_static),
+          napi_getter_setter_property(
+              "autoBatch", export_NotifyIcon_get_autoBatch,
+              export_NotifyIcon_set_autoBatch, napi_static),
+          napi_getter_property("batchStats", export_NotifyIcon_get_batchStats,
+                               napi_static),
+          napi_getter_property("modifyStats",
+                               export_NotifyIcon_get_modifyStats, napi_static),
+          napi_getter_property("eventStats", export_NotifyIcon_get_eventStats,
+                               napi_static),
+          napi_getter_setter_property(
+              "dispatchQueueLimit", export_NotifyIcon_get_dispatchQueueLimit,
+              export_NotifyIcon_set_dispatchQueueLimit, napi_static),
+          napi_getter_property("dispatchStats",
+                               export_NotifyIcon_get_dispatchStats,
+                               napi_static),
+      });
+}
+
+napi_status NotifyIconObject::request_tooltip(napi_env env,
+                                             napi_value this_value) {
+  if (!tooltip_request_callback || !display_id) {
+    return napi_ok;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (tooltip_requested_at && now - tooltip_requested_at.value() < tooltip_ttl) {
+    return napi_ok;
+  }
+  tooltip_requested_at = now;
+  tooltip_request_count++;
+
+  auto result = tooltip_request_callback(this_value, {});
+  if (!result) {
+    // Threw, which is left to be reported.
+    return napi_ok;
+  }
+
+  notify_icon_options options;
+  NAPI_RETURN_IF_NOT_OK(napi_get_value(env, result, &options.tooltip));
+  if (!options.tooltip) {
+    return napi_ok;
+  }
+
+  // Sent with the rest of the batch, replacing any older tooltip in it.
+  if (batched_options) {
+    batched_options->tooltip = std::move(options.tooltip);
+    return napi_ok;
+  }
+  // Sent once they complete, so an older one can't overwrite it.
+  if (pending_shell_calls) {
+    requested_tooltip = std::move(options.tooltip);
+    return napi_ok;
+  }
+
+  // Through the shell, so a tooltip held back by tooltipMinIntervalMs is
+  // replaced rather than sent after this one.
+  std::lock_guard lock{shell->mutex};
+  if (!shell->modify(options)) {
+    napi_throw_win32_error(env, "Shell_NotifyIconW");
+    return napi_pending_exception;
+  }
   return napi_ok;
 }
+
+napi_status NotifyIconObject::remove(napi_env env) {
+  if (!display_id) {
+    return napi_ok;
+  }
+
+  {
+    std::lock_guard lock{shell->mutex};
+    if (!shell->icon.clear()) {
+      napi_throw_win32_error(env, "Shell_NotifyIconW");
+      return napi_pending_exception;
+    }
+  }
+
+  removed(env);
+  return napi_ok;
+}
+
+void NotifyIconObject::removed(napi_env env) {
+  if (!display_id) {
+    return;
+  }
+
+  auto env_data = get_env_data(env);
+  // Still registered, for passing to the events_available_callback below.
+  napi_value this_value = nullptr;
+  if (auto it = env_data->icons.find(display_id.callback_id);
+      it != env_data->icons.end()) {
+    napi_get_reference_value(env, it->second.ref, &this_value);
+  }
+
+  set_shown_icon_ref(this, {});
+  env_data->remove_icon(display_id.callback_id);
+  display_id = {};
+
+  // No longer shown, so they can be evicted (or collected).
+  set_pinned_icon_ref(notification_icon_ref, {});
+  for (auto& [name, state] : states) {
+    pin_state_icon(state, -1);
+  }
+  states.clear();
+
+  shell->detach();
+  tooltip_updater_arrays.clear();
+  clear_command_ring(this);
+
+  // Let anything waiting on events, e.g. the iterator from events(), see the
+  // icon is gone.
+  shell->event_mask = 0;
+  shell->take_events(SIZE_MAX);
+  auto callback = std::move(events_available_callback);
+  if (callback && this_value) {
+    callback(this_value, {});
+  }
+  env_data->trim_icons();
+}
@@ -1,25 +1,191 @@
 #pragma once
 
+#include "command-ring.hh"
 #include "data.hh"
 #include "icon-object.hh"
 #include "notify-icon.hh"
+#include "strand.hh"
+#include "tooltip-updater.hh"
+#include "unique.hh"
 #include "napi/wrap.hh"
 
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+// The name used for `type` in JS, e.g. "mouseMove".
+std::string_view notify_icon_event_name(notify_icon_event type);
+
+// The parts of a notify icon used off the JS thread: by the *Async() methods
+// on the strand, and by timers on the message thread. Shell calls are made
+// with `mutex` held.
+struct NotifyIconShell : std::enable_shared_from_this<NotifyIconShell> {
+  using clock = std::chrono::steady_clock;
+
+  std::mutex mutex;
+  NotifyIcon icon;
+  // Null once detached, see detach().
+  NotifyIconMessageLoop* loop = nullptr;
+
+  // Tooltips updated sooner than tooltip_min_interval after the last one sent
+  // are held in pending_tooltip, and only the latest is sent when the interval
+  // is up.
+  std::atomic<std::chrono::milliseconds> tooltip_min_interval{};
+  clock::time_point tooltip_sent_at;
+  std::optional<std::wstring> pending_tooltip;
+  std::atomic<uint64_t> tooltips_sent = 0;
+  // Replaced by a later tooltip before they were sent.
+  std::atomic<uint64_t> tooltips_dropped = 0;
+
+  // Replaces the tooltip whenever its counters change, polled on the message
+  // thread. Replacing it ends the previous one's timer chain.
+  std::unique_ptr<TooltipUpdater> tooltip_updater;
+  uint32_t tooltip_updater_generation = 0;
+  std::atomic<uint64_t> tooltip_updater_sent = 0;
+
+  // notify_icon_event bits the message thread should pass on to JS.
+  std::atomic<uint32_t> event_mask = 0;
+
+  // What to lose when event_buffer_size events are already waiting.
+  enum event_overflow_policy {
+    drop_oldest,
+    drop_newest,
+    // Replace the latest waiting event of the same type, if any, otherwise
+    // drop the oldest.
+    coalesce,
+  };
+  struct push_event_result {
+    bool merged = false;
+    bool dropped = false;
+    // The JS thread hasn't been told about waiting events yet.
+    bool wake = false;
+  };
+  // Events waiting for the JS thread, guarded by events_mutex rather than
+  // `mutex` so the message thread never waits on a shell call to buffer them.
+  // A mouse move always replaces any waiting.
+  std::mutex events_mutex;
+  std::deque<EnvData::NotifyEventArgs> events;
+  uint32_t event_buffer_size = 256;
+  event_overflow_policy event_overflow = drop_oldest;
+  bool events_woken = false;
+  std::atomic<uint64_t> events_dropped = 0;
+
+  push_event_result push_event(const EnvData::NotifyEventArgs& args);
+  // Removes up to `max` of the oldest waiting events. The JS thread will be
+  // woken again for the next event only once none are left.
+  std::vector<EnvData::NotifyEventArgs> take_events(size_t max);
+
+  // If notification_min_interval and notification_queue_limit are set, each
+  // notification is shown for at least that long, with later ones queued by
+  // priority. Identical queued notifications are shown once, with a count, and
+  // ones identical to the notification being shown are dropped.
+  struct queued_notification {
+    notify_icon_options::notification_options options;
+    // A copy, as the icon object may have been evicted by the time it's shown.
+    Unique<HICON, DestroyIcon> icon;
+    uint32_t count = 1;
+  };
+  std::atomic<std::chrono::milliseconds> notification_min_interval{};
+  std::atomic<uint32_t> notification_queue_limit = 16;
+  clock::time_point notification_sent_at;
+  // The title and text of the notification last shown, until it's removed, so
+  // identical notifications queued while it's shown are merged into it.
+  struct shown_notification_text {
+    std::optional<std::wstring> title;
+    std::optional<std::wstring> text;
+  };
+  std::optional<shown_notification_text> shown_notification;
+  std::vector<queued_notification> notification_queue;
+  std::atomic<uint64_t> notification_queue_depth = 0;
+  std::atomic<uint64_t> notifications_sent = 0;
+  std::atomic<uint64_t> notifications_merged = 0;
+  // Lowest priority, when the queue was full.
+  std::atomic<uint64_t> notifications_dropped = 0;
+
+  bool add(const notify_icon_id& new_id, const notify_icon_options& options);
+  bool modify(notify_icon_options options);
+  bool modify(const notify_icon_prepared_modify& prepared);
+  void set_tooltip_updater(std::unique_ptr<TooltipUpdater> updater);
+  // On the message thread, adds the icon again as last shown, if it hasn't
+  // been removed.
+  bool restore();
+  // Stops using the message loop and anything else the environment owns, once
+  // the icon has been removed or the environment is being torn down. Held back
+  // updates are dropped, and timers already set do nothing when they fire.
+  void detach();
+
+ private:
+  // When the message thread timer to send held back updates will fire, if set.
+  std::optional<clock::time_point> timer_due;
+
+  void queue_notification(notify_icon_options::notification_options options);
+  void schedule(clock::time_point due);
+  void flush();
+  void schedule_tooltip_update(DWORD delay_ms);
+  void update_tooltip(uint32_t generation);
+};
+
 struct NotifyIconObject : NapiWrapped<NotifyIconObject> {
   static napi_status define_class(EnvData* env_data,
                                   napi_value* constructor_value);
 
   napi_env env_ = nullptr;
-  NotifyIcon notify_icon;
+  std::shared_ptr<NotifyIconShell> shell = std::make_shared<NotifyIconShell>();
+  std::shared_ptr<Strand> strand = std::make_shared<Strand>();
+  // shell->icon.id as of the last completed shell call, readable from the JS
+  // thread without waiting on the strand.
+  notify_icon_id display_id;
   bool large_balloon_icon = false;
   NapiUnwrappedRef<IconObject> icon_ref;
   NapiUnwrappedRef<IconObject> notification_icon_ref;
   NapiAsyncCallback select_callback;
+  // Called with the events in event_mask, see EnvData::notify_event().
+  NapiAsyncCallback events_callback;
+  // Instead of events_callback, called without arguments when events are
+  // waiting, leaving them to be pulled with takeEvents().
+  NapiAsyncCallback events_available_callback;
+  uint32_t event_mask = notify_icon_event_all;
+  // Called for the tooltip when the user hovers, if the last result is older
+  // than tooltip_ttl.
+  NapiAsyncCallback tooltip_request_callback;
+  std::chrono::milliseconds tooltip_ttl{1000};
+  std::optional<std::chrono::steady_clock::time_point> tooltip_requested_at;
+  uint64_t tooltip_request_count = 0;
+  // Named combinations of options defined ahead of time by defineStates(), so
+  // setState() is a lookup and a shell call. Their icons stay pinned.
+  struct state {
+    std::optional<NapiUnwrappedRef<IconObject>> icon_ref;
+    notify_icon_prepared_modify modify;
+  };
+  std::unordered_map<std::string, state> states;
+  // The SharedArrayBuffers the tooltip updater reads.
+  std::vector<NapiRef> tooltip_updater_arrays;
+  // Set by setCommandRing(), with the array it reads and copies of the states
+  // it can pick from, whose icons stay pinned until it's replaced.
+  std::shared_ptr<CommandRing> command_ring;
+  NapiRef command_ring_array;
+  std::vector<state> command_ring_states;
+  // Merged updates waiting for the current batch to end.
+  std::optional<notify_icon_options> batched_options;
+  // *Async() calls posted to the strand that haven't completed. Updates made
+  // directly while any are pending could be overwritten by them, so are
+  // rejected.
+  uint32_t pending_shell_calls = 0;
+  // Returned by tooltip_request_callback while *Async() calls were pending,
+  // sent once they complete unless one of them sets a newer tooltip.
+  std::optional<std::wstring> requested_tooltip;
 
   napi_status select(napi_env env, napi_value this_value, bool right_button,
                      int16_t mouse_x, int16_t mouse_y);
 
+  napi_status request_tooltip(napi_env env, napi_value this_value);
+  // The shell has events waiting, see EnvData::deliver_events().
+  napi_status events_woken(napi_env env, napi_value this_value);
+
   napi_status remove(napi_env env);
+  // Releases what the icon held once the shell has deleted it.
+  void removed(napi_env env);
 
  private:
   friend NapiWrapped;
@@ -2,17 +2,14 @@
 
 #include <shellapi.h>
 
-template <size_t N>
-wchar_t* copy(const std::wstring& s, wchar_t (&dest)[N]) {
-  return std::copy(s.begin(), s.end(), dest);
-}
+#include "bounded-text.hh"
 
+// Truncated to fit, rather than overflowing the fixed size buffers.
 template <size_t N>
-wchar_t* copy(const std::optional<std::wstring>& maybe_s, wchar_t (&dest)[N]) {
-  if (!maybe_s) {
-    return dest;
+void copy(const std::optional<std::wstring>& maybe_s, wchar_t (&dest)[N]) {
+  if (maybe_s) {
+    copy_bounded_text(maybe_s.value(), dest);
   }
-  return copy(maybe_s.value(), dest);
 }
 
 static NOTIFYICONDATAW make_data(const notify_icon_id& id) {
@@ -45,7 +42,7 @@ static NOTIFYICONDATAW make_data(const notify_icon_id& id,
 
   if (options.tooltip) {
     data.uFlags |= NIF_TIP | NIF_SHOWTIP;
-    copy(options.tooltip.value(), data.szTip);
+    copy(options.tooltip, data.szTip);
   }
 
   if (options.notification) {
@@ -71,6 +68,22 @@ static NOTIFYICONDATAW make_data(const notify_icon_id& id,
   return data;
 }
 
+void merge_notify_icon_options(notify_icon_options* into,
+                               const notify_icon_options& from) {
+  if (from.hidden) into->hidden = from.hidden;
+  if (from.icon) into->icon = from.icon;
+  if (from.tooltip) into->tooltip = from.tooltip;
+  if (from.notification) into->notification = from.notification;
+}
+
+void prepare_modify_notify_icon(const notify_icon_id& id,
+                                const notify_icon_options& options,
+                                notify_icon_prepared_modify* result) {
+  result->options = options;
+  result->options.notification.reset();
+  result->data = make_data(id, result->options);
+}
+
 bool add_notify_icon(const notify_icon_id& id,
                      const notify_icon_options& options,
                      DWORD callback_message) {
@@ -94,6 +107,59 @@ bool modify_notify_icon(const notify_icon_id& id,
   return Shell_NotifyIconW(NIM_MODIFY, &data);
 }
 
+notify_icon_modify_stats notify_icon_stats;
+
+template <typename T>
+static void strip_unchanged(std::optional<T>& option,
+                            const std::optional<T>& shown) {
+  if (option && option == shown) option.reset();
+}
+
+bool NotifyIcon::modify(const notify_icon_options& options) {
+  auto changed = options;
+  strip_unchanged(changed.hidden, shown.hidden);
+  strip_unchanged(changed.icon, shown.icon);
+  strip_unchanged(changed.tooltip, shown.tooltip);
+
+  if (!changed.hidden && !changed.icon && !changed.tooltip &&
+      !changed.notification) {
+    notify_icon_stats.skipped++;
+    return true;
+  }
+
+  notify_icon_stats.sent++;
+  if (!modify_notify_icon(id, changed)) {
+    return false;
+  }
+  merge_notify_icon_options(&shown, changed);
+  shown.notification.reset();
+  return true;
+}
+
+template <typename T>
+static bool is_shown(const std::optional<T>& option,
+                     const std::optional<T>& shown) {
+  return !option || option == shown;
+}
+
+bool NotifyIcon::modify(const notify_icon_prepared_modify& prepared) {
+  auto& options = prepared.options;
+  if (is_shown(options.hidden, shown.hidden) &&
+      is_shown(options.icon, shown.icon) &&
+      is_shown(options.tooltip, shown.tooltip)) {
+    notify_icon_stats.skipped++;
+    return true;
+  }
+
+  notify_icon_stats.sent++;
+  auto data = prepared.data;
+  if (!Shell_NotifyIconW(NIM_MODIFY, &data)) {
+    return false;
+  }
+  merge_notify_icon_options(&shown, options);
+  return true;
+}
+
 bool delete_notify_icon(const notify_icon_id& id) {
   auto data = make_data(id);
   return Shell_NotifyIconW(NIM_DELETE, &data);
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <optional>
 #include <string>
 
 #include <Windows.h>
+#include <shellapi.h>
 
 struct notify_icon_id {
   HWND callback_hwnd = nullptr;
@@ -28,6 +30,8 @@ struct notify_icon_options {
     bool large_icon;
     std::optional<std::wstring> title;
     std::optional<std::wstring> text;
+    // Not sent, orders notifications waiting to be shown.
+    int32_t priority = 0;
   };
 
   // dwState: NIS_*
@@ -38,6 +42,21 @@ struct notify_icon_options {
   std::optional<notification_options> notification;
 };
 
+// Sets each option in `from` in `into`, replacing any notification as a whole.
+void merge_notify_icon_options(notify_icon_options* into,
+                               const notify_icon_options& from);
+
+// A NIM_MODIFY built ahead of time, for options that are sent repeatedly.
+// Notifications are not supported, as they are not state.
+struct notify_icon_prepared_modify {
+  notify_icon_options options;
+  NOTIFYICONDATAW data;
+};
+
+void prepare_modify_notify_icon(const notify_icon_id& id,
+                                const notify_icon_options& options,
+                                notify_icon_prepared_modify* result);
+
 bool add_notify_icon(const notify_icon_id& id,
                      const notify_icon_options& options,
                      DWORD callback_message);
@@ -45,15 +64,29 @@ bool modify_notify_icon(const notify_icon_id& id,
                         const notify_icon_options& options);
 bool delete_notify_icon(const notify_icon_id& id);
 
+// Process-wide counts of NotifyIcon::modify() calls.
+struct notify_icon_modify_stats {
+  std::atomic<uint64_t> sent = 0;
+  // Nothing had changed, so the shell wasn't called.
+  std::atomic<uint64_t> skipped = 0;
+};
+
+extern notify_icon_modify_stats notify_icon_stats;
+
 struct NotifyIcon {
   notify_icon_id id;
+  // The state last sent to the shell, so unchanged options aren't sent again.
+  // Notifications are not state: each one is shown, even if it's the same.
+  notify_icon_options shown;
 
   NotifyIcon() = default;
   NotifyIcon(const NotifyIcon&) = delete;
   NotifyIcon& operator=(const NotifyIcon&) = delete;
-  NotifyIcon(NotifyIcon&& other) noexcept : id{std::exchange(other.id, {})} {}
+  NotifyIcon(NotifyIcon&& other) noexcept
+      : id{std::exchange(other.id, {})}, shown{std::move(other.shown)} {}
   NotifyIcon& operator=(NotifyIcon&& other) noexcept {
     std::swap(id, other.id);
+    std::swap(shown, other.shown);
     return *this;
   }
 
@@ -64,11 +97,19 @@ struct NotifyIcon {
       return false;
     }
     id = new_id;
+    shown = {};
+    merge_notify_icon_options(&shown, options);
+    shown.notification.reset();
     return true;
   }
 
-  bool modify(const notify_icon_options& options) {
-    return modify_notify_icon(id, options);
+  // Only sends the options that differ from what's shown, if any.
+  bool modify(const notify_icon_options& options);
+  bool modify(const notify_icon_prepared_modify& prepared);
+
+  // Adds what's shown again, after the shell has lost it by restarting.
+  bool restore(DWORD callback_message) {
+    return !id || add_notify_icon(id, shown, callback_message);
   }
 
   bool clear() {
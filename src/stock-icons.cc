@@ -0,0 +1,123 @@
+#include "stock-icons.hh"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include <ShlObj.h>
+#include <shellapi.h>
+
+struct stock_icon_name {
+  std::string_view name;
+  SHSTOCKICONID id;
+};
+
+// Sorted by name, for binary search.
+static constexpr stock_icon_name stock_icon_names[] = {
+    {"application-x-executable", SIID_APPLICATION},
+    {"applications-system", SIID_SOFTWARE},
+    {"audio-x-generic", SIID_AUDIOFILES},
+    {"camera-photo", SIID_DEVICECAMERA},
+    {"camera-video", SIID_DEVICEVIDEOCAMERA},
+    {"dialog-error", SIID_ERROR},
+    {"dialog-information", SIID_INFO},
+    {"dialog-password", SIID_KEY},
+    {"dialog-question", SIID_HELP},
+    {"dialog-warning", SIID_WARNING},
+    {"document-print", SIID_PRINTER},
+    {"drive-harddisk", SIID_DRIVEFIXED},
+    {"drive-optical", SIID_DRIVECD},
+    {"drive-removable-media", SIID_DRIVEREMOVE},
+    {"edit-delete", SIID_DELETE},
+    {"edit-find", SIID_FIND},
+    {"emblem-shared", SIID_SHARE},
+    {"emblem-symbolic-link", SIID_LINK},
+    {"folder", SIID_FOLDER},
+    {"folder-open", SIID_FOLDEROPEN},
+    {"folder-remote", SIID_DRIVENET},
+    {"help-browser", SIID_HELP},
+    {"image-x-generic", SIID_IMAGEFILES},
+    {"multimedia-player", SIID_DEVICEAUDIOPLAYER},
+    {"network", SIID_MYNETWORK},
+    {"network-offline", SIID_DRIVENETDISABLED},
+    {"network-server", SIID_SERVER},
+    {"network-wired", SIID_NETWORKCONNECT},
+    {"network-workgroup", SIID_MYNETWORK},
+    {"package-x-generic", SIID_ZIPFILE},
+    {"phone", SIID_DEVICECELLPHONE},
+    {"preferences-system", SIID_SETTINGS},
+    {"printer", SIID_PRINTER},
+    {"security-high", SIID_SHIELD},
+    {"system-lock-screen", SIID_LOCK},
+    {"system-search", SIID_FIND},
+    {"text-x-generic", SIID_DOCNOASSOC},
+    {"user-trash", SIID_RECYCLER},
+    {"user-trash-full", SIID_RECYCLERFULL},
+    {"video-x-generic", SIID_VIDEOFILES},
+    {"web-browser", SIID_INTERNET},
+};
+
+static const stock_icon_name* find_stock_icon_name(std::string_view name) {
+  auto end = std::end(stock_icon_names);
+  auto it = std::lower_bound(
+      std::begin(stock_icon_names), end, name,
+      [](const stock_icon_name& item, std::string_view name) {
+        return item.name < name;
+      });
+  return it != end && it->name == name ? it : nullptr;
+}
+
+struct stock_icon_location {
+  std::wstring path;
+  int index = 0;
+};
+
+// SHGetStockIconInfo() is relatively slow, and the locations don't change.
+static std::mutex locations_mutex;
+static std::unordered_map<SHSTOCKICONID, stock_icon_location> locations;
+
+static HRESULT get_stock_icon_location(SHSTOCKICONID id,
+                                       stock_icon_location* result) {
+  std::lock_guard lock{locations_mutex};
+  if (auto it = locations.find(id); it != locations.end()) {
+    *result = it->second;
+    return S_OK;
+  }
+
+  SHSTOCKICONINFO info = {sizeof(info)};
+  if (auto hr = SHGetStockIconInfo(id, SHGSI_ICONLOCATION, &info); FAILED(hr)) {
+    return hr;
+  }
+  result->path = info.szPath;
+  result->index = info.iIcon;
+  locations.insert({id, *result});
+  return S_OK;
+}
+
+icon_bitmap_error load_stock_icon(std::string_view name, int32_t size,
+                                  HICON* result) {
+  *result = nullptr;
+
+  auto item = find_stock_icon_name(name);
+  while (!item) {
+    auto dash = name.rfind('-');
+    if (dash == name.npos) {
+      return {};
+    }
+    name = name.substr(0, dash);
+    item = find_stock_icon_name(name);
+  }
+
+  stock_icon_location location;
+  if (auto hr = get_stock_icon_location(item->id, &location); FAILED(hr)) {
+    return {"SHGetStockIconInfo", hr};
+  }
+
+  auto hr = SHDefExtractIconW(location.path.c_str(), location.index, 0, result,
+                              nullptr, MAKELONG(size, size));
+  if (hr != S_OK) {
+    *result = nullptr;
+    return {"SHDefExtractIconW", FAILED(hr) ? hr : ERROR_FILE_NOT_FOUND};
+  }
+  return {};
+}
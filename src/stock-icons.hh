@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+
+#include "icon-bitmap.hh"
+
+// Loads the stock icon best matching a freedesktop.org icon naming spec name,
+// e.g. "network-offline", as an owned handle.
+//
+// Follows the naming spec fallback of removing dash-separated suffixes, e.g.
+// "folder-documents-symbolic" matches "folder". Sets `result` to nullptr if
+// there is no match at all.
+icon_bitmap_error load_stock_icon(std::string_view name, int32_t size,
+                                  HICON* result);
@@ -0,0 +1,39 @@
+#include "strand.hh"
+
+bool Strand::post(std::function<void()> task) {
+  std::lock_guard lock{mutex};
+  tasks.push_back(std::move(task));
+  if (running) {
+    return true;
+  }
+
+  // Keeps the strand alive until it has drained.
+  auto self = std::make_unique<std::shared_ptr<Strand>>(shared_from_this());
+  if (!TrySubmitThreadpoolCallback(run, self.get(), nullptr)) {
+    tasks.pop_back();
+    return false;
+  }
+  self.release();
+  running = true;
+  return true;
+}
+
+void CALLBACK Strand::run(PTP_CALLBACK_INSTANCE instance, void* context) {
+  std::unique_ptr<std::shared_ptr<Strand>> self{
+      static_cast<std::shared_ptr<Strand>*>(context)};
+  auto strand = self->get();
+
+  while (true) {
+    std::function<void()> task;
+    {
+      std::lock_guard lock{strand->mutex};
+      if (strand->tasks.empty()) {
+        strand->running = false;
+        return;
+      }
+      task = std::move(strand->tasks.front());
+      strand->tasks.pop_front();
+    }
+    task();
+  }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <Windows.h>
+
+// Runs tasks on the system thread pool one at a time, in the order they were
+// posted. Tasks on different strands may run in parallel.
+struct Strand : std::enable_shared_from_this<Strand> {
+  // Returns false if the pool couldn't take the task, in which case it is
+  // dropped.
+  bool post(std::function<void()> task);
+
+ private:
+  static void CALLBACK run(PTP_CALLBACK_INSTANCE instance, void* context);
+
+  std::mutex mutex;
+  std::deque<std::function<void()>> tasks;
+  bool running = false;
+};
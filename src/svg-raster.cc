@@ -0,0 +1,1435 @@
+#include "svg-raster.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <unordered_map>
+
+constexpr float pi = 3.14159265358979f;
+
+// Max distance in pixels a flattened curve can be from the real curve.
+constexpr float flatten_tolerance = 0.1f;
+// Vertical samples per pixel row, horizontal coverage is computed exactly.
+constexpr int sub_scanlines = 5;
+
+struct point {
+  float x = 0;
+  float y = 0;
+};
+
+static point operator+(point a, point b) { return {a.x + b.x, a.y + b.y}; }
+static point operator-(point a, point b) { return {a.x - b.x, a.y - b.y}; }
+static point operator*(point a, float s) { return {a.x * s, a.y * s}; }
+static float length(point a) { return std::sqrt(a.x * a.x + a.y * a.y); }
+static bool is_finite(point a) {
+  return std::isfinite(a.x) && std::isfinite(a.y);
+}
+
+// x' = a x + c y + e, y' = b x + d y + f
+struct affine {
+  float a = 1, b = 0, c = 0, d = 1, e = 0, f = 0;
+
+  point apply(point p) const {
+    return {a * p.x + c * p.y + e, b * p.x + d * p.y + f};
+  }
+
+  // Applies other first, then this.
+  affine operator*(const affine& o) const {
+    return {a * o.a + c * o.b,     b * o.a + d * o.b,
+            a * o.c + c * o.d,     b * o.c + d * o.d,
+            a * o.e + c * o.f + e, b * o.e + d * o.f + f};
+  }
+
+  float scale() const { return std::sqrt(std::abs(a * d - b * c)); }
+
+  bool is_finite() const {
+    return std::isfinite(a) && std::isfinite(b) && std::isfinite(c) &&
+           std::isfinite(d) && std::isfinite(e) && std::isfinite(f);
+  }
+
+  std::optional<affine> inverse() const {
+    auto det = a * d - b * c;
+    if (std::abs(det) < 1e-12f) return std::nullopt;
+    auto inv = 1 / det;
+    return affine{d * inv,
+                  -b * inv,
+                  -c * inv,
+                  a * inv,
+                  (c * f - d * e) * inv,
+                  (b * e - a * f) * inv};
+  }
+};
+
+// Minimal XML ----------------------------------------------------------------
+
+struct xml_element {
+  std::string_view name;
+  std::vector<std::pair<std::string_view, std::string_view>> attributes;
+  std::vector<xml_element> children;
+
+  std::optional<std::string_view> attribute(std::string_view key) const {
+    for (auto& [name, value] : attributes) {
+      if (name == key) return value;
+    }
+    return std::nullopt;
+  }
+};
+
+struct xml_parser {
+  std::string_view source;
+  size_t pos = 0;
+  std::string error;
+
+  bool at_end() const { return pos >= source.size(); }
+  bool starts_with(std::string_view s) const {
+    return source.substr(pos, s.size()) == s;
+  }
+
+  void skip_space() {
+    while (!at_end() && std::isspace((unsigned char)source[pos])) pos++;
+  }
+
+  bool skip_past(std::string_view end) {
+    auto found = source.find(end, pos);
+    if (found == std::string_view::npos) {
+      error = "unterminated " + std::string(end);
+      return false;
+    }
+    pos = found + end.size();
+    return true;
+  }
+
+  // Skips text, comments, processing instructions and doctypes up to the next
+  // element tag or closing tag.
+  bool skip_misc() {
+    while (true) {
+      auto next = source.find('<', pos);
+      if (next == std::string_view::npos) {
+        pos = source.size();
+        return true;
+      }
+      pos = next;
+      if (starts_with("<!--")) {
+        if (!skip_past("-->")) return false;
+      } else if (starts_with("<![CDATA[")) {
+        if (!skip_past("]]>")) return false;
+      } else if (starts_with("<?") || starts_with("<!")) {
+        if (!skip_past(">")) return false;
+      } else {
+        return true;
+      }
+    }
+  }
+
+  std::string_view read_name() {
+    auto start = pos;
+    while (!at_end()) {
+      auto c = source[pos];
+      if (std::isspace((unsigned char)c) || c == '=' || c == '>' ||
+          c == '/') {
+        break;
+      }
+      pos++;
+    }
+    return source.substr(start, pos - start);
+  }
+
+  static std::string_view local_name(std::string_view name) {
+    auto colon = name.find(':');
+    return colon == std::string_view::npos ? name : name.substr(colon + 1);
+  }
+
+  // Parses the element starting at a '<', `depth` elements deep.
+  bool parse_element(xml_element* result, int depth = 0) {
+    if (depth == max_svg_depth) {
+      error = "elements nested too deeply";
+      return false;
+    }
+    pos++;  // '<'
+    result->name = local_name(read_name());
+    if (result->name.empty()) {
+      error = "expected element name";
+      return false;
+    }
+
+    while (true) {
+      skip_space();
+      if (at_end()) {
+        error = "unterminated element";
+        return false;
+      }
+      if (starts_with("/>")) {
+        pos += 2;
+        return true;
+      }
+      if (source[pos] == '>') {
+        pos++;
+        break;
+      }
+      auto name = read_name();
+      skip_space();
+      if (name.empty() || at_end() || source[pos] != '=') {
+        error = "expected attribute value";
+        return false;
+      }
+      pos++;
+      skip_space();
+      if (at_end() || (source[pos] != '"' && source[pos] != '\'')) {
+        error = "expected quoted attribute value";
+        return false;
+      }
+      auto quote = source[pos++];
+      auto end = source.find(quote, pos);
+      if (end == std::string_view::npos) {
+        error = "unterminated attribute value";
+        return false;
+      }
+      // Keep namespace prefixes other than xlink, e.g. xmlns:foo is ignored.
+      auto key = name.substr(0, 6) == "xlink:" ? local_name(name) : name;
+      result->attributes.emplace_back(key, source.substr(pos, end - pos));
+      pos = end + 1;
+    }
+
+    while (true) {
+      if (!skip_misc()) return false;
+      if (at_end()) {
+        error = "unterminated element <" + std::string(result->name) + ">";
+        return false;
+      }
+      if (starts_with("</")) {
+        return skip_past(">");
+      }
+      if (!parse_element(&result->children.emplace_back(), depth + 1)) {
+        return false;
+      }
+    }
+  }
+
+  bool parse_document(xml_element* result) {
+    if (!skip_misc()) return false;
+    if (at_end()) {
+      error = "no root element";
+      return false;
+    }
+    return parse_element(result);
+  }
+};
+
+// Values ---------------------------------------------------------------------
+
+struct number_parser {
+  std::string_view source;
+  size_t pos = 0;
+
+  bool at_end() const { return pos >= source.size(); }
+
+  void skip_separators() {
+    while (!at_end() &&
+           (std::isspace((unsigned char)source[pos]) || source[pos] == ',')) {
+      pos++;
+    }
+  }
+
+  bool read_number(float* result) {
+    skip_separators();
+    auto start = pos;
+    if (!at_end() && (source[pos] == '+' || source[pos] == '-')) pos++;
+    bool digits = false;
+    while (!at_end() && std::isdigit((unsigned char)source[pos])) {
+      pos++;
+      digits = true;
+    }
+    if (!at_end() && source[pos] == '.') {
+      pos++;
+      while (!at_end() && std::isdigit((unsigned char)source[pos])) {
+        pos++;
+        digits = true;
+      }
+    }
+    if (!digits) {
+      pos = start;
+      return false;
+    }
+    if (!at_end() && (source[pos] == 'e' || source[pos] == 'E')) {
+      auto exponent = pos++;
+      if (!at_end() && (source[pos] == '+' || source[pos] == '-')) pos++;
+      if (at_end() || !std::isdigit((unsigned char)source[pos])) {
+        pos = exponent;
+      } else {
+        while (!at_end() && std::isdigit((unsigned char)source[pos])) pos++;
+      }
+    }
+    auto value = std::strtof(
+        std::string(source.substr(start, pos - start)).c_str(), nullptr);
+    // Out of range, e.g. "1e39", which would reach the rasterizer as inf.
+    if (!std::isfinite(value)) {
+      pos = start;
+      return false;
+    }
+    *result = value;
+    return true;
+  }
+
+  // Arc flags can be written without separators, e.g. "a1 1 0 011 1".
+  bool read_flag(bool* result) {
+    skip_separators();
+    if (at_end() || (source[pos] != '0' && source[pos] != '1')) return false;
+    *result = source[pos++] == '1';
+    return true;
+  }
+};
+
+static std::string_view trim(std::string_view s) {
+  while (!s.empty() && std::isspace((unsigned char)s.front())) s.remove_prefix(1);
+  while (!s.empty() && std::isspace((unsigned char)s.back())) s.remove_suffix(1);
+  return s;
+}
+
+// Ignores units, which is right for px and user units, the only ones that make
+// sense for icons.
+static std::optional<float> parse_length(std::optional<std::string_view> s) {
+  if (!s) return std::nullopt;
+  number_parser parser{s.value()};
+  float value;
+  if (!parser.read_number(&value)) return std::nullopt;
+  if (!parser.at_end() && parser.source[parser.pos] == '%') return std::nullopt;
+  return value;
+}
+
+static float parse_length_or(std::optional<std::string_view> s,
+                             float default_value) {
+  return parse_length(s).value_or(default_value);
+}
+
+struct color {
+  float r = 0, g = 0, b = 0;
+};
+
+static std::optional<color> parse_color(std::string_view s) {
+  s = trim(s);
+  if (s.empty()) return std::nullopt;
+
+  if (s[0] == '#') {
+    auto hex = s.substr(1);
+    auto digit = [](char c) -> int {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return -1;
+    };
+    for (auto c : hex) {
+      if (digit(c) < 0) return std::nullopt;
+    }
+    if (hex.size() == 3) {
+      return color{digit(hex[0]) * 17 / 255.0f, digit(hex[1]) * 17 / 255.0f,
+                   digit(hex[2]) * 17 / 255.0f};
+    }
+    if (hex.size() == 6) {
+      return color{(digit(hex[0]) * 16 + digit(hex[1])) / 255.0f,
+                   (digit(hex[2]) * 16 + digit(hex[3])) / 255.0f,
+                   (digit(hex[4]) * 16 + digit(hex[5])) / 255.0f};
+    }
+    return std::nullopt;
+  }
+
+  if (s.substr(0, 4) == "rgb(" && s.back() == ')') {
+    number_parser parser{s.substr(4, s.size() - 5)};
+    float channels[3];
+    for (auto& channel : channels) {
+      if (!parser.read_number(&channel)) return std::nullopt;
+      if (!parser.at_end() && parser.source[parser.pos] == '%') {
+        parser.pos++;
+        channel = channel * 255 / 100;
+      }
+      channel = std::clamp(channel / 255, 0.0f, 1.0f);
+    }
+    return color{channels[0], channels[1], channels[2]};
+  }
+
+  static const std::pair<std::string_view, uint32_t> named[] = {
+      {"black", 0x000000},  {"white", 0xffffff},   {"red", 0xff0000},
+      {"lime", 0x00ff00},   {"green", 0x008000},   {"blue", 0x0000ff},
+      {"yellow", 0xffff00}, {"cyan", 0x00ffff},    {"aqua", 0x00ffff},
+      {"magenta", 0xff00ff}, {"fuchsia", 0xff00ff}, {"gray", 0x808080},
+      {"grey", 0x808080},   {"silver", 0xc0c0c0},  {"maroon", 0x800000},
+      {"olive", 0x808000},  {"navy", 0x000080},    {"purple", 0x800080},
+      {"teal", 0x008080},   {"orange", 0xffa500},
+  };
+  for (auto& [name, rgb] : named) {
+    if (name == s) {
+      return color{(rgb >> 16) / 255.0f, ((rgb >> 8) & 0xff) / 255.0f,
+                   (rgb & 0xff) / 255.0f};
+    }
+  }
+  return std::nullopt;
+}
+
+static affine parse_transform(std::string_view s) {
+  affine result;
+  size_t pos = 0;
+  while (pos < s.size()) {
+    auto open = s.find('(', pos);
+    auto close = s.find(')', pos);
+    if (open == std::string_view::npos || close == std::string_view::npos ||
+        close < open) {
+      break;
+    }
+    auto name = trim(s.substr(pos, open - pos));
+    if (!name.empty() && name.front() == ',') name = trim(name.substr(1));
+
+    number_parser parser{s.substr(open + 1, close - open - 1)};
+    float args[6] = {};
+    int count = 0;
+    while (count < 6 && parser.read_number(&args[count])) count++;
+
+    affine t;
+    if (name == "matrix" && count == 6) {
+      t = {args[0], args[1], args[2], args[3], args[4], args[5]};
+    } else if (name == "translate" && count >= 1) {
+      t.e = args[0];
+      t.f = count > 1 ? args[1] : 0;
+    } else if (name == "scale" && count >= 1) {
+      t.a = args[0];
+      t.d = count > 1 ? args[1] : args[0];
+    } else if (name == "rotate" && count >= 1) {
+      auto angle = args[0] * pi / 180;
+      affine r{std::cos(angle), std::sin(angle), -std::sin(angle),
+               std::cos(angle), 0, 0};
+      if (count == 3) {
+        t = affine{1, 0, 0, 1, args[1], args[2]} * r *
+            affine{1, 0, 0, 1, -args[1], -args[2]};
+      } else {
+        t = r;
+      }
+    } else if (name == "skewX" && count == 1) {
+      t.c = std::tan(args[0] * pi / 180);
+    } else if (name == "skewY" && count == 1) {
+      t.b = std::tan(args[0] * pi / 180);
+    }
+    // Overflowing, ignored along with the rest as if it was invalid.
+    if (!(result * t).is_finite()) {
+      break;
+    }
+    result = result * t;
+    pos = close + 1;
+  }
+  return result;
+}
+
+// Geometry -------------------------------------------------------------------
+
+// A sequence of line ('L') and cubic ('C') segments from points[0]. Lines use
+// one point, cubics three.
+struct subpath {
+  std::vector<point> points;
+  std::vector<char> ops;
+  bool closed = false;
+};
+
+struct path_builder {
+  std::vector<subpath> subpaths;
+
+  subpath& current() {
+    if (subpaths.empty()) subpaths.emplace_back().points.push_back({});
+    return subpaths.back();
+  }
+
+  point last() { return current().points.back(); }
+
+  void move_to(point p) {
+    if (!subpaths.empty() && subpaths.back().ops.empty()) {
+      subpaths.back().points.back() = p;
+    } else {
+      subpaths.emplace_back().points.push_back(p);
+    }
+  }
+
+  void line_to(point p) {
+    auto& sp = current();
+    sp.points.push_back(p);
+    sp.ops.push_back('L');
+  }
+
+  void cubic_to(point c1, point c2, point p) {
+    auto& sp = current();
+    sp.points.insert(sp.points.end(), {c1, c2, p});
+    sp.ops.push_back('C');
+  }
+
+  void close() {
+    if (subpaths.empty()) return;
+    auto& sp = subpaths.back();
+    sp.closed = true;
+    auto start = sp.points.front();
+    // Following commands start from the start of the closed subpath.
+    subpaths.emplace_back().points.push_back(start);
+  }
+
+  // SVG arc implementation notes, F.6.5 "Conversion from endpoint to center
+  // parameterization", then split into cubics of at most 90 degrees.
+  void arc_to(float rx, float ry, float rotation, bool large_arc, bool sweep,
+              point p) {
+    auto p0 = last();
+    rx = std::abs(rx);
+    ry = std::abs(ry);
+    if (rx == 0 || ry == 0 || (p0.x == p.x && p0.y == p.y)) {
+      line_to(p);
+      return;
+    }
+
+    auto phi = rotation * pi / 180;
+    auto cos_phi = std::cos(phi), sin_phi = std::sin(phi);
+    auto dx = (p0.x - p.x) / 2, dy = (p0.y - p.y) / 2;
+    auto x1 = cos_phi * dx + sin_phi * dy;
+    auto y1 = -sin_phi * dx + cos_phi * dy;
+
+    auto lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+    if (lambda > 1) {
+      rx *= std::sqrt(lambda);
+      ry *= std::sqrt(lambda);
+    }
+
+    auto num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    auto den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    auto coef = std::sqrt(std::max(0.0f, num / den));
+    if (large_arc == sweep) coef = -coef;
+    auto cx1 = coef * rx * y1 / ry;
+    auto cy1 = -coef * ry * x1 / rx;
+    auto cx = cos_phi * cx1 - sin_phi * cy1 + (p0.x + p.x) / 2;
+    auto cy = sin_phi * cx1 + cos_phi * cy1 + (p0.y + p.y) / 2;
+
+    auto angle = [](float ux, float uy, float vx, float vy) {
+      return std::atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+    };
+    auto theta1 = angle(1, 0, (x1 - cx1) / rx, (y1 - cy1) / ry);
+    auto delta = angle((x1 - cx1) / rx, (y1 - cy1) / ry, (-x1 - cx1) / rx,
+                       (-y1 - cy1) / ry);
+    if (!sweep && delta > 0) delta -= 2 * pi;
+    if (sweep && delta < 0) delta += 2 * pi;
+
+    // fmax() rather than std::max(), so NaN from degenerate radii becomes 1.
+    auto segments =
+        (int)std::fmax(std::ceil(std::abs(delta) / (pi / 2) - 1e-4f), 1.0f);
+    auto step = delta / segments;
+    auto k = 4.0f / 3 * std::tan(step / 4);
+
+    // Maps a point relative to the unit circle to the ellipse.
+    auto at = [&](float ex, float ey) {
+      auto x = rx * ex, y = ry * ey;
+      return point{cos_phi * x - sin_phi * y + cx,
+                   sin_phi * x + cos_phi * y + cy};
+    };
+
+    auto t = theta1;
+    for (int i = 0; i != segments; i++) {
+      auto t2 = t + step;
+      auto c1 = at(std::cos(t) - k * std::sin(t), std::sin(t) + k * std::cos(t));
+      auto c2 =
+          at(std::cos(t2) + k * std::sin(t2), std::sin(t2) - k * std::cos(t2));
+      auto end = i + 1 == segments ? p : at(std::cos(t2), std::sin(t2));
+      cubic_to(c1, c2, end);
+      t = t2;
+    }
+  }
+
+  void ellipse(float cx, float cy, float rx, float ry) {
+    constexpr float kappa = 0.5522847f;
+    auto kx = rx * kappa, ky = ry * kappa;
+    move_to({cx + rx, cy});
+    cubic_to({cx + rx, cy + ky}, {cx + kx, cy + ry}, {cx, cy + ry});
+    cubic_to({cx - kx, cy + ry}, {cx - rx, cy + ky}, {cx - rx, cy});
+    cubic_to({cx - rx, cy - ky}, {cx - kx, cy - ry}, {cx, cy - ry});
+    cubic_to({cx + kx, cy - ry}, {cx + rx, cy - ky}, {cx + rx, cy});
+    close();
+  }
+};
+
+static bool parse_path_data(std::string_view d, path_builder* builder) {
+  number_parser parser{d};
+  char command = 0;
+  point last_control;
+  char last_command = 0;
+
+  while (true) {
+    parser.skip_separators();
+    if (parser.at_end()) break;
+    auto c = parser.source[parser.pos];
+    if (std::isalpha((unsigned char)c)) {
+      command = c;
+      parser.pos++;
+    } else if (!command) {
+      return false;
+    }
+
+    auto relative = std::islower((unsigned char)command) != 0;
+    auto origin = relative ? builder->last() : point{};
+    auto read_point = [&](point* p) {
+      if (!parser.read_number(&p->x) || !parser.read_number(&p->y))
+        return false;
+      *p = *p + origin;
+      return true;
+    };
+
+    auto upper = (char)std::toupper((unsigned char)command);
+    switch (upper) {
+      case 'M': {
+        point p;
+        if (!read_point(&p)) return false;
+        builder->move_to(p);
+        // Subsequent pairs are implicit line-tos.
+        command = relative ? 'l' : 'L';
+        break;
+      }
+      case 'L': {
+        point p;
+        if (!read_point(&p)) return false;
+        builder->line_to(p);
+        break;
+      }
+      case 'H': {
+        float x;
+        if (!parser.read_number(&x)) return false;
+        builder->line_to({x + origin.x, builder->last().y});
+        break;
+      }
+      case 'V': {
+        float y;
+        if (!parser.read_number(&y)) return false;
+        builder->line_to({builder->last().x, y + origin.y});
+        break;
+      }
+      case 'C': {
+        point c1, c2, p;
+        if (!read_point(&c1) || !read_point(&c2) || !read_point(&p))
+          return false;
+        builder->cubic_to(c1, c2, p);
+        last_control = c2;
+        break;
+      }
+      case 'S': {
+        point c2, p;
+        if (!read_point(&c2) || !read_point(&p)) return false;
+        auto p0 = builder->last();
+        auto c1 = (last_command == 'C' || last_command == 'S')
+                      ? p0 * 2 - last_control
+                      : p0;
+        builder->cubic_to(c1, c2, p);
+        last_control = c2;
+        break;
+      }
+      case 'Q':
+      case 'T': {
+        point q, p;
+        auto p0 = builder->last();
+        if (upper == 'Q') {
+          if (!read_point(&q)) return false;
+        } else {
+          q = (last_command == 'Q' || last_command == 'T')
+                  ? p0 * 2 - last_control
+                  : p0;
+        }
+        if (!read_point(&p)) return false;
+        builder->cubic_to(p0 + (q - p0) * (2.0f / 3),
+                          p + (q - p) * (2.0f / 3), p);
+        last_control = q;
+        break;
+      }
+      case 'A': {
+        float rx, ry, rotation;
+        bool large_arc, sweep;
+        point p;
+        if (!parser.read_number(&rx) || !parser.read_number(&ry) ||
+            !parser.read_number(&rotation) || !parser.read_flag(&large_arc) ||
+            !parser.read_flag(&sweep) || !read_point(&p)) {
+          return false;
+        }
+        builder->arc_to(rx, ry, rotation, large_arc, sweep, p);
+        break;
+      }
+      case 'Z':
+        builder->close();
+        break;
+      default:
+        return false;
+    }
+    last_command = upper;
+  }
+  return true;
+}
+
+static void parse_points(std::string_view s, path_builder* builder,
+                         bool close) {
+  number_parser parser{s};
+  point p;
+  bool first = true;
+  while (parser.read_number(&p.x) && parser.read_number(&p.y)) {
+    if (first) {
+      builder->move_to(p);
+      first = false;
+    } else {
+      builder->line_to(p);
+    }
+  }
+  if (close && !first) builder->close();
+}
+
+// Flattened polygons in device pixels.
+struct polyline {
+  std::vector<point> points;
+  bool closed = false;
+};
+
+static std::vector<polyline> flatten(const std::vector<subpath>& subpaths,
+                                     const affine& transform) {
+  std::vector<polyline> result;
+  for (auto& sp : subpaths) {
+    if (sp.ops.empty()) continue;
+    auto& out = result.emplace_back();
+    out.closed = sp.closed;
+    // Points overflowing once transformed are dropped, as they can't be
+    // rasterized.
+    auto add_point = [&](point p) {
+      if (is_finite(p)) out.points.push_back(p);
+    };
+    auto p0 = transform.apply(sp.points[0]);
+    add_point(p0);
+    size_t index = 1;
+    for (auto op : sp.ops) {
+      if (op == 'L') {
+        p0 = transform.apply(sp.points[index++]);
+        add_point(p0);
+        continue;
+      }
+      auto p1 = transform.apply(sp.points[index]);
+      auto p2 = transform.apply(sp.points[index + 1]);
+      auto p3 = transform.apply(sp.points[index + 2]);
+      index += 3;
+      if (!is_finite(p0) || !is_finite(p1) || !is_finite(p2) ||
+          !is_finite(p3)) {
+        add_point(p3);
+        p0 = p3;
+        continue;
+      }
+      // Wang's formula for the number of line segments needed.
+      auto dd = std::max(length(p0 - p1 * 2 + p2), length(p1 - p2 * 2 + p3));
+      // Clamped before the cast, as dd can overflow.
+      auto n = (int)std::fmax(
+          std::fmin(std::ceil(std::sqrt(0.75f * dd / flatten_tolerance)),
+                    100.0f),
+          1.0f);
+      for (int i = 1; i <= n; i++) {
+        auto t = (float)i / n, u = 1 - t;
+        add_point(p0 * (u * u * u) + p1 * (3 * u * u * t) +
+                  p2 * (3 * u * t * t) + p3 * (t * t * t));
+      }
+      p0 = p3;
+    }
+  }
+  return result;
+}
+
+// Rasterization --------------------------------------------------------------
+
+struct edge {
+  float x0, y0, x1, y1;
+  int winding;
+};
+
+enum class fill_rule { nonzero, evenodd };
+
+struct coverage_mask {
+  int32_t width, height;
+  std::vector<float> coverage;
+};
+
+static void add_polygon(std::vector<edge>& edges,
+                        const std::vector<point>& points) {
+  for (size_t i = 0; i != points.size(); i++) {
+    auto a = points[i];
+    auto b = points[(i + 1) % points.size()];
+    // E.g. stroke outlines offset past the float range.
+    if (!is_finite(a) || !is_finite(b) || a.y == b.y) continue;
+    if (a.y < b.y) {
+      edges.push_back({a.x, a.y, b.x, b.y, 1});
+    } else {
+      edges.push_back({b.x, b.y, a.x, a.y, -1});
+    }
+  }
+}
+
+static void add_span(float* row, int32_t width, float x0, float x1,
+                     float weight) {
+  // The clamps below would pass NaN through to the casts.
+  if (std::isnan(x0) || std::isnan(x1)) return;
+  x0 = std::max(x0, 0.0f);
+  x1 = std::min(x1, (float)width);
+  if (x0 >= x1) return;
+  auto i0 = (int32_t)x0, i1 = (int32_t)x1;
+  if (i0 == i1) {
+    row[i0] += (x1 - x0) * weight;
+    return;
+  }
+  row[i0] += (i0 + 1 - x0) * weight;
+  for (auto i = i0 + 1; i < i1; i++) row[i] += weight;
+  if (i1 < width) row[i1] += (x1 - i1) * weight;
+}
+
+static void rasterize(std::vector<edge> edges, fill_rule rule,
+                      coverage_mask* mask) {
+  std::fill(mask->coverage.begin(), mask->coverage.end(), 0.0f);
+  std::sort(edges.begin(), edges.end(),
+            [](const edge& a, const edge& b) { return a.y0 < b.y0; });
+
+  struct crossing {
+    float x;
+    int winding;
+  };
+  std::vector<const edge*> active;
+  std::vector<crossing> crossings;
+  size_t next_edge = 0;
+  constexpr float weight = 1.0f / sub_scanlines;
+
+  for (int32_t y = 0; y != mask->height; y++) {
+    auto row = mask->coverage.data() + (size_t)y * mask->width;
+    for (int s = 0; s != sub_scanlines; s++) {
+      auto sy = y + (s + 0.5f) * weight;
+      while (next_edge != edges.size() && edges[next_edge].y0 <= sy) {
+        active.push_back(&edges[next_edge++]);
+      }
+      active.erase(std::remove_if(active.begin(), active.end(),
+                                  [=](const edge* e) { return e->y1 <= sy; }),
+                   active.end());
+
+      crossings.clear();
+      for (auto e : active) {
+        if (sy < e->y0) continue;
+        auto x = e->x0 + (sy - e->y0) * (e->x1 - e->x0) / (e->y1 - e->y0);
+        // Edges spanning more than the float range, which std::sort can't
+        // order.
+        if (std::isnan(x)) continue;
+        crossings.push_back({x, e->winding});
+      }
+      std::sort(crossings.begin(), crossings.end(),
+                [](const crossing& a, const crossing& b) { return a.x < b.x; });
+
+      int winding = 0;
+      for (size_t i = 0; i + 1 < crossings.size(); i++) {
+        winding += crossings[i].winding;
+        auto inside = rule == fill_rule::nonzero ? winding != 0 : winding & 1;
+        if (inside) {
+          add_span(row, mask->width, crossings[i].x, crossings[i + 1].x,
+                   weight);
+        }
+      }
+    }
+  }
+}
+
+// Stroking -------------------------------------------------------------------
+
+enum class line_cap { butt, round, square };
+enum class line_join { miter, round, bevel };
+
+struct stroke_params {
+  float half_width;
+  line_cap cap;
+  line_join join;
+  float miter_limit;
+};
+
+// Every stroke piece is added as a separate polygon with the same orientation,
+// so filling them with the nonzero rule draws their union.
+static void add_oriented(std::vector<edge>& edges, std::vector<point> points) {
+  float area = 0;
+  for (size_t i = 0; i != points.size(); i++) {
+    auto a = points[i];
+    auto b = points[(i + 1) % points.size()];
+    area += a.x * b.y - b.x * a.y;
+  }
+  if (area < 0) std::reverse(points.begin(), points.end());
+  add_polygon(edges, points);
+}
+
+static void add_disc(std::vector<edge>& edges, point center, float radius) {
+  auto n = (int)std::fmax(std::fmin(std::ceil(radius * 2), 64.0f), 8.0f);
+  std::vector<point> points(n);
+  for (int i = 0; i != n; i++) {
+    auto t = 2 * pi * i / n;
+    points[i] = {center.x + radius * std::cos(t),
+                 center.y + radius * std::sin(t)};
+  }
+  add_oriented(edges, std::move(points));
+}
+
+static void add_join(std::vector<edge>& edges, point prev, point at,
+                     point next, const stroke_params& params) {
+  auto hw = params.half_width;
+  if (params.join == line_join::round) {
+    add_disc(edges, at, hw);
+    return;
+  }
+
+  auto d0 = at - prev, d1 = next - at;
+  auto l0 = length(d0), l1 = length(d1);
+  if (l0 == 0 || l1 == 0) return;
+  d0 = d0 * (1 / l0);
+  d1 = d1 * (1 / l1);
+  auto cross = d0.x * d1.y - d0.y * d1.x;
+  if (std::abs(cross) < 1e-6f) return;
+  // The outer side of the turn.
+  auto side = cross > 0 ? -1.0f : 1.0f;
+  point n0{-d0.y * side * hw, d0.x * side * hw};
+  point n1{-d1.y * side * hw, d1.x * side * hw};
+
+  if (params.join == line_join::miter) {
+    // miter length / stroke width = 1 / sin(theta / 2), where theta is the
+    // angle between the segments, so pi - the angle of the turn.
+    auto cos_turn = d0.x * d1.x + d0.y * d1.y;
+    auto ratio = 1 / std::sqrt(std::max(1e-6f, (1 + cos_turn) / 2));
+    if (ratio <= params.miter_limit) {
+      auto bisector = n0 + n1;
+      auto bl = length(bisector);
+      if (bl > 0) {
+        auto tip = at + bisector * (hw * ratio / bl);
+        add_oriented(edges, {at, at + n0, tip, at + n1});
+        return;
+      }
+    }
+  }
+  add_oriented(edges, {at, at + n0, at + n1});
+}
+
+static void add_stroke(std::vector<edge>& edges, const polyline& line,
+                       const stroke_params& params) {
+  // Drop repeated points, they have no direction.
+  std::vector<point> points;
+  for (auto p : line.points) {
+    if (points.empty() || length(p - points.back()) > 1e-4f) {
+      points.push_back(p);
+    }
+  }
+  auto closed = line.closed;
+  if (closed && points.size() > 1 &&
+      length(points.front() - points.back()) <= 1e-4f) {
+    points.pop_back();
+  }
+
+  auto hw = params.half_width;
+  if (points.size() == 1) {
+    // Zero length subpaths only draw round or square caps.
+    if (params.cap == line_cap::round) {
+      add_disc(edges, points[0], hw);
+    } else if (params.cap == line_cap::square) {
+      auto p = points[0];
+      add_oriented(edges, {{p.x - hw, p.y - hw},
+                           {p.x + hw, p.y - hw},
+                           {p.x + hw, p.y + hw},
+                           {p.x - hw, p.y + hw}});
+    }
+    return;
+  }
+
+  auto segment_count = closed ? points.size() : points.size() - 1;
+  for (size_t i = 0; i != segment_count; i++) {
+    auto a = points[i];
+    auto b = points[(i + 1) % points.size()];
+    auto d = b - a;
+    auto l = length(d);
+    d = d * (1 / l);
+    point n{-d.y * hw, d.x * hw};
+    if (!closed && params.cap == line_cap::square) {
+      if (i == 0) a = a - d * hw;
+      if (i + 1 == segment_count) b = b + d * hw;
+    }
+    add_oriented(edges, {a + n, b + n, b - n, a - n});
+  }
+
+  auto count = points.size();
+  for (size_t i = closed ? 0 : 1; i != (closed ? count : count - 1); i++) {
+    add_join(edges, points[(i + count - 1) % count], points[i],
+             points[(i + 1) % count], params);
+  }
+
+  if (!closed && params.cap == line_cap::round) {
+    add_disc(edges, points.front(), hw);
+    add_disc(edges, points.back(), hw);
+  }
+}
+
+// Painting -------------------------------------------------------------------
+
+struct gradient_stop {
+  float offset;
+  color rgb;
+  float opacity;
+};
+
+struct gradient {
+  bool radial = false;
+  bool user_space = false;
+  affine transform;
+  // linear: x1 y1 x2 y2, radial: cx cy r
+  float x1 = 0, y1 = 0, x2 = 1, y2 = 0;
+  float cx = 0.5f, cy = 0.5f, r = 0.5f;
+  std::vector<gradient_stop> stops;
+};
+
+struct paint {
+  enum kind_t { none, solid, url } kind = none;
+  color rgb;
+  std::string_view id;
+};
+
+struct style {
+  paint fill{paint::solid};
+  paint stroke;
+  float fill_opacity = 1;
+  float stroke_opacity = 1;
+  float opacity = 1;
+  float stroke_width = 1;
+  fill_rule rule = fill_rule::nonzero;
+  line_cap cap = line_cap::butt;
+  line_join join = line_join::miter;
+  float miter_limit = 4;
+  bool visible = true;
+};
+
+static float parse_opacity(std::string_view s) {
+  return std::clamp(parse_length_or(s, 1), 0.0f, 1.0f);
+}
+
+static std::optional<paint> parse_paint(std::string_view s) {
+  s = trim(s);
+  if (s == "none" || s == "transparent") return paint{paint::none};
+  if (s.substr(0, 4) == "url(") {
+    auto close = s.find(')');
+    if (close == std::string_view::npos) return std::nullopt;
+    auto ref = trim(s.substr(4, close - 4));
+    if (!ref.empty() && (ref.front() == '\'' || ref.front() == '"')) {
+      ref = ref.substr(1, ref.size() - 2);
+    }
+    if (ref.empty() || ref.front() != '#') return std::nullopt;
+    return paint{paint::url, {}, ref.substr(1)};
+  }
+  // No `color` property support, so currentColor is the initial black.
+  if (s == "currentColor") return paint{paint::solid};
+  if (auto rgb = parse_color(s)) return paint{paint::solid, rgb.value()};
+  return std::nullopt;
+}
+
+static void apply_property(style* result, std::string_view name,
+                           std::string_view value) {
+  value = trim(value);
+  if (value == "inherit") return;
+  if (name == "fill") {
+    if (auto p = parse_paint(value)) result->fill = p.value();
+  } else if (name == "stroke") {
+    if (auto p = parse_paint(value)) result->stroke = p.value();
+  } else if (name == "fill-opacity") {
+    result->fill_opacity = parse_opacity(value);
+  } else if (name == "stroke-opacity") {
+    result->stroke_opacity = parse_opacity(value);
+  } else if (name == "opacity") {
+    // Approximates group opacity by applying it to each shape.
+    result->opacity *= parse_opacity(value);
+  } else if (name == "stroke-width") {
+    result->stroke_width = std::max(0.0f, parse_length_or(value, 1));
+  } else if (name == "fill-rule") {
+    result->rule = value == "evenodd" ? fill_rule::evenodd : fill_rule::nonzero;
+  } else if (name == "stroke-linecap") {
+    result->cap = value == "round"    ? line_cap::round
+                  : value == "square" ? line_cap::square
+                                      : line_cap::butt;
+  } else if (name == "stroke-linejoin") {
+    result->join = value == "round"   ? line_join::round
+                   : value == "bevel" ? line_join::bevel
+                                      : line_join::miter;
+  } else if (name == "stroke-miterlimit") {
+    result->miter_limit = std::max(1.0f, parse_length_or(value, 4));
+  } else if (name == "display" || name == "visibility") {
+    if (value == "none" || value == "hidden") result->visible = false;
+  }
+}
+
+// Presentation attributes first, then `style` overrides them.
+static style cascade(const style& parent, const xml_element& element) {
+  auto result = parent;
+  for (auto& [name, value] : element.attributes) {
+    if (name != "style") apply_property(&result, name, value);
+  }
+  if (auto declarations = element.attribute("style")) {
+    auto s = declarations.value();
+    while (!s.empty()) {
+      auto end = s.find(';');
+      auto declaration = s.substr(0, end);
+      auto colon = declaration.find(':');
+      if (colon != std::string_view::npos) {
+        apply_property(&result, trim(declaration.substr(0, colon)),
+                       declaration.substr(colon + 1));
+      }
+      if (end == std::string_view::npos) break;
+      s.remove_prefix(end + 1);
+    }
+  }
+  return result;
+}
+
+struct renderer {
+  int32_t width, height;
+  // Premultiplied RGBA.
+  std::vector<float> canvas;
+  coverage_mask mask;
+  std::unordered_map<std::string_view, gradient> gradients;
+
+  void collect_gradients(const xml_element& element) {
+    if (element.name == "linearGradient" || element.name == "radialGradient") {
+      if (auto id = element.attribute("id")) {
+        gradients[id.value()] = parse_gradient(element);
+      }
+    }
+    for (auto& child : element.children) collect_gradients(child);
+  }
+
+  gradient parse_gradient(const xml_element& element) {
+    gradient result;
+    // Inherit attributes and stops from a referenced gradient, if it was
+    // defined first.
+    if (auto href = element.attribute("href");
+        href && !href->empty() && href->front() == '#') {
+      if (auto it = gradients.find(href->substr(1)); it != gradients.end()) {
+        result = it->second;
+      }
+    }
+    result.radial = element.name == "radialGradient";
+    if (auto units = element.attribute("gradientUnits")) {
+      result.user_space = units.value() == "userSpaceOnUse";
+    }
+    if (auto transform = element.attribute("gradientTransform")) {
+      result.transform = parse_transform(transform.value());
+    }
+    result.x1 = parse_length_or(element.attribute("x1"), result.x1);
+    result.y1 = parse_length_or(element.attribute("y1"), result.y1);
+    result.x2 = parse_length_or(element.attribute("x2"), result.x2);
+    result.y2 = parse_length_or(element.attribute("y2"), result.y2);
+    result.cx = parse_length_or(element.attribute("cx"), result.cx);
+    result.cy = parse_length_or(element.attribute("cy"), result.cy);
+    result.r = parse_length_or(element.attribute("r"), result.r);
+
+    std::vector<gradient_stop> stops;
+    for (auto& child : element.children) {
+      if (child.name != "stop") continue;
+      gradient_stop stop{0, {}, 1};
+      for (auto& [name, value] : child.attributes) {
+        if (name == "offset") {
+          number_parser parser{value};
+          float offset = 0;
+          if (parser.read_number(&offset) && !parser.at_end() &&
+              parser.source[parser.pos] == '%') {
+            offset /= 100;
+          }
+          stop.offset = std::clamp(offset, 0.0f, 1.0f);
+        }
+      }
+      auto apply = [&](std::string_view name, std::string_view value) {
+        if (name == "stop-color") {
+          if (auto rgb = parse_color(value)) stop.rgb = rgb.value();
+        } else if (name == "stop-opacity") {
+          stop.opacity = parse_opacity(value);
+        }
+      };
+      for (auto& [name, value] : child.attributes) apply(name, value);
+      if (auto declarations = child.attribute("style")) {
+        auto s = declarations.value();
+        while (!s.empty()) {
+          auto end = s.find(';');
+          auto declaration = s.substr(0, end);
+          auto colon = declaration.find(':');
+          if (colon != std::string_view::npos) {
+            apply(trim(declaration.substr(0, colon)),
+                  trim(declaration.substr(colon + 1)));
+          }
+          if (end == std::string_view::npos) break;
+          s.remove_prefix(end + 1);
+        }
+      }
+      // Offsets must be non-decreasing.
+      if (!stops.empty()) stop.offset = std::max(stop.offset, stops.back().offset);
+      stops.push_back(stop);
+    }
+    if (!stops.empty()) result.stops = std::move(stops);
+    return result;
+  }
+
+  struct rgba {
+    float r, g, b, a;
+  };
+
+  static rgba sample(const std::vector<gradient_stop>& stops, float t) {
+    t = std::isnan(t) ? 0 : std::clamp(t, 0.0f, 1.0f);
+    if (t <= stops.front().offset) {
+      auto& s = stops.front();
+      return {s.rgb.r, s.rgb.g, s.rgb.b, s.opacity};
+    }
+    for (size_t i = 1; i != stops.size(); i++) {
+      auto& b = stops[i];
+      if (t > b.offset) continue;
+      auto& a = stops[i - 1];
+      auto span = b.offset - a.offset;
+      auto u = span > 0 ? (t - a.offset) / span : 1;
+      return {a.rgb.r + (b.rgb.r - a.rgb.r) * u,
+              a.rgb.g + (b.rgb.g - a.rgb.g) * u,
+              a.rgb.b + (b.rgb.b - a.rgb.b) * u,
+              a.opacity + (b.opacity - a.opacity) * u};
+    }
+    auto& s = stops.back();
+    return {s.rgb.r, s.rgb.g, s.rgb.b, s.opacity};
+  }
+
+  // Composites the current mask with the paint, source-over.
+  void composite(const paint& p, float opacity, const affine& transform,
+                 const point& bbox_min, const point& bbox_max) {
+    const gradient* g = nullptr;
+    std::optional<affine> to_gradient;
+    if (p.kind == paint::url) {
+      auto it = gradients.find(p.id);
+      if (it == gradients.end() || it->second.stops.empty()) return;
+      g = &it->second;
+      auto space = transform;
+      if (!g->user_space) {
+        space = space * affine{bbox_max.x - bbox_min.x, 0, 0,
+                               bbox_max.y - bbox_min.y, bbox_min.x,
+                               bbox_min.y};
+      }
+      to_gradient = (space * g->transform).inverse();
+      if (!to_gradient) return;
+    }
+
+    for (int32_t y = 0; y != height; y++) {
+      auto row = mask.coverage.data() + (size_t)y * width;
+      for (int32_t x = 0; x != width; x++) {
+        auto coverage = std::min(row[x], 1.0f);
+        if (coverage <= 0) continue;
+
+        rgba src{p.rgb.r, p.rgb.g, p.rgb.b, 1};
+        if (g) {
+          auto q = to_gradient->apply({x + 0.5f, y + 0.5f});
+          float t;
+          if (g->radial) {
+            t = g->r > 0 ? length(q - point{g->cx, g->cy}) / g->r : 1;
+          } else {
+            auto dx = g->x2 - g->x1, dy = g->y2 - g->y1;
+            auto dd = dx * dx + dy * dy;
+            t = dd > 0 ? ((q.x - g->x1) * dx + (q.y - g->y1) * dy) / dd : 0;
+          }
+          src = sample(g->stops, t);
+        }
+
+        auto alpha = src.a * opacity * coverage;
+        auto dst = &canvas[((size_t)y * width + x) * 4];
+        auto keep = 1 - alpha;
+        dst[0] = src.r * alpha + dst[0] * keep;
+        dst[1] = src.g * alpha + dst[1] * keep;
+        dst[2] = src.b * alpha + dst[2] * keep;
+        dst[3] = alpha + dst[3] * keep;
+      }
+    }
+  }
+
+  void draw_shape(const std::vector<subpath>& subpaths, const style& s,
+                  const affine& transform) {
+    if (subpaths.empty()) return;
+
+    point bbox_min{INFINITY, INFINITY}, bbox_max{-INFINITY, -INFINITY};
+    for (auto& sp : subpaths) {
+      if (sp.ops.empty()) continue;
+      for (auto& p : sp.points) {
+        bbox_min = {std::min(bbox_min.x, p.x), std::min(bbox_min.y, p.y)};
+        bbox_max = {std::max(bbox_max.x, p.x), std::max(bbox_max.y, p.y)};
+      }
+    }
+    if (bbox_min.x > bbox_max.x) return;
+
+    auto lines = flatten(subpaths, transform);
+
+    if (s.fill.kind != paint::none) {
+      std::vector<edge> edges;
+      for (auto& line : lines) add_polygon(edges, line.points);
+      rasterize(std::move(edges), s.rule, &mask);
+      composite(s.fill, s.fill_opacity * s.opacity, transform, bbox_min,
+                bbox_max);
+    }
+
+    if (s.stroke.kind != paint::none && s.stroke_width > 0) {
+      stroke_params params{s.stroke_width * transform.scale() / 2, s.cap,
+                           s.join, s.miter_limit};
+      std::vector<edge> edges;
+      for (auto& line : lines) add_stroke(edges, line, params);
+      rasterize(std::move(edges), fill_rule::nonzero, &mask);
+      composite(s.stroke, s.stroke_opacity * s.opacity, transform, bbox_min,
+                bbox_max);
+    }
+  }
+
+  void draw(const xml_element& element, const style& parent_style,
+            const affine& parent_transform) {
+    auto& name = element.name;
+    if (name == "defs" || name == "linearGradient" ||
+        name == "radialGradient" || name == "title" || name == "desc" ||
+        name == "metadata" || name == "clipPath" || name == "mask" ||
+        name == "symbol" || name == "style") {
+      return;
+    }
+
+    auto s = cascade(parent_style, element);
+    if (!s.visible) return;
+    auto transform = parent_transform;
+    if (auto t = element.attribute("transform")) {
+      transform = transform * parse_transform(t.value());
+    }
+
+    if (name == "g" || name == "svg") {
+      for (auto& child : element.children) draw(child, s, transform);
+      return;
+    }
+
+    auto attr = [&](std::string_view key) {
+      return parse_length_or(element.attribute(key), 0);
+    };
+
+    path_builder builder;
+    if (name == "path") {
+      if (auto d = element.attribute("d")) {
+        // Render up to the first error, as browsers do.
+        parse_path_data(d.value(), &builder);
+      }
+    } else if (name == "rect") {
+      auto x = attr("x"), y = attr("y"), w = attr("width"), h = attr("height");
+      if (w <= 0 || h <= 0) return;
+      auto rx = parse_length(element.attribute("rx"));
+      auto ry = parse_length(element.attribute("ry"));
+      if (!rx) rx = ry;
+      if (!ry) ry = rx;
+      auto rxv = std::clamp(rx.value_or(0.0f), 0.0f, w / 2);
+      auto ryv = std::clamp(ry.value_or(0.0f), 0.0f, h / 2);
+      if (rxv > 0 && ryv > 0) {
+        builder.move_to({x + rxv, y});
+        builder.line_to({x + w - rxv, y});
+        builder.arc_to(rxv, ryv, 0, false, true, {x + w, y + ryv});
+        builder.line_to({x + w, y + h - ryv});
+        builder.arc_to(rxv, ryv, 0, false, true, {x + w - rxv, y + h});
+        builder.line_to({x + rxv, y + h});
+        builder.arc_to(rxv, ryv, 0, false, true, {x, y + h - ryv});
+        builder.line_to({x, y + ryv});
+        builder.arc_to(rxv, ryv, 0, false, true, {x + rxv, y});
+      } else {
+        builder.move_to({x, y});
+        builder.line_to({x + w, y});
+        builder.line_to({x + w, y + h});
+        builder.line_to({x, y + h});
+      }
+      builder.close();
+    } else if (name == "circle") {
+      auto r = attr("r");
+      if (r <= 0) return;
+      builder.ellipse(attr("cx"), attr("cy"), r, r);
+    } else if (name == "ellipse") {
+      auto rx = attr("rx"), ry = attr("ry");
+      if (rx <= 0 || ry <= 0) return;
+      builder.ellipse(attr("cx"), attr("cy"), rx, ry);
+    } else if (name == "line") {
+      builder.move_to({attr("x1"), attr("y1")});
+      builder.line_to({attr("x2"), attr("y2")});
+      // Lines have no interior.
+      s.fill.kind = paint::none;
+    } else if (name == "polyline" || name == "polygon") {
+      if (auto points = element.attribute("points")) {
+        parse_points(points.value(), &builder, name == "polygon");
+      }
+    } else {
+      return;
+    }
+
+    draw_shape(builder.subpaths, s, transform);
+  }
+
+  void to_bitmap(IconBitmap* result) const {
+    result->width = width;
+    result->height = height;
+    result->pixels.resize((size_t)width * height);
+    for (size_t i = 0; i != result->pixels.size(); i++) {
+      auto src = &canvas[i * 4];
+      auto a = std::clamp(src[3], 0.0f, 1.0f);
+      uint32_t pixel = 0;
+      if (a > 0) {
+        auto channel = [&](float premultiplied) {
+          return (uint32_t)std::lround(
+              std::clamp(premultiplied / a, 0.0f, 1.0f) * 255);
+        };
+        pixel = (uint32_t)std::lround(a * 255) << 24 | channel(src[0]) << 16 |
+                channel(src[1]) << 8 | channel(src[2]);
+      }
+      result->pixels[i] = pixel;
+    }
+  }
+};
+
+bool rasterize_svg(std::string_view source, int32_t width, int32_t height,
+                   IconBitmap* result, std::string* error) {
+  if (width <= 0 || height <= 0) {
+    *error = "size must be positive";
+    return false;
+  }
+  if (width > max_svg_size || height > max_svg_size) {
+    *error = "size must be at most " + std::to_string(max_svg_size);
+    return false;
+  }
+
+  xml_parser parser{source};
+  xml_element root;
+  if (!parser.parse_document(&root)) {
+    *error = parser.error;
+    return false;
+  }
+  if (root.name != "svg") {
+    *error = "root element is not <svg>";
+    return false;
+  }
+
+  // Fit the viewBox, or the intrinsic size, to the requested size, centered.
+  float view_x = 0, view_y = 0;
+  float view_width = parse_length_or(root.attribute("width"), (float)width);
+  float view_height = parse_length_or(root.attribute("height"), (float)height);
+  if (auto view_box = root.attribute("viewBox")) {
+    number_parser numbers{view_box.value()};
+    float values[4];
+    if (numbers.read_number(&values[0]) && numbers.read_number(&values[1]) &&
+        numbers.read_number(&values[2]) && numbers.read_number(&values[3]) &&
+        values[2] > 0 && values[3] > 0) {
+      view_x = values[0];
+      view_y = values[1];
+      view_width = values[2];
+      view_height = values[3];
+    }
+  }
+  if (view_width <= 0 || view_height <= 0) {
+    *error = "empty viewBox";
+    return false;
+  }
+  auto scale = std::min(width / view_width, height / view_height);
+  affine transform{scale,
+                   0,
+                   0,
+                   scale,
+                   (width - view_width * scale) / 2 - view_x * scale,
+                   (height - view_height * scale) / 2 - view_y * scale};
+
+  renderer r{width, height};
+  r.canvas.resize((size_t)width * height * 4);
+  r.mask = {width, height, std::vector<float>((size_t)width * height)};
+  r.collect_gradients(root);
+  r.draw(root, style{}, transform);
+  r.to_bitmap(result);
+  return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "icon-pixels.hh"
+
+// Limits for untrusted documents: parsing and drawing recurse per element, and
+// the canvas is allocated up front.
+constexpr int max_svg_depth = 256;
+constexpr int32_t max_svg_size = 1024;
+
+// Renders the subset of SVG commonly used for icons: <svg>, <g>, <defs>,
+// <path>, <rect>, <circle>, <ellipse>, <line>, <polyline> and <polygon>, with
+// solid, linear and radial gradient fills and strokes, transforms, and the
+// usual presentation attributes and `style` properties.
+//
+// The document viewBox is fitted to `width` x `height` (xMidYMid meet).
+// Returns false and sets `error` if the document can't be parsed, nests
+// elements deeper than max_svg_depth, or either size is over max_svg_size.
+bool rasterize_svg(std::string_view source, int32_t width, int32_t height,
+                   IconBitmap* result, std::string* error);
@@ -0,0 +1,170 @@
+#include "tooltip-updater.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+
+#include "bounded-text.hh"
+
+// NOTIFYICONDATAW::szTip, without the terminator.
+constexpr size_t max_tooltip_length = 127;
+
+bool TooltipUpdater::parse_template(const std::wstring& text) {
+  segments.clear();
+  segments.emplace_back();
+  for (size_t i = 0; i != text.size(); i++) {
+    auto c = text[i];
+    if (c == L'{' && i + 1 != text.size() && text[i + 1] == L'{') {
+      segments.back().text += L'{';
+      i++;
+      continue;
+    }
+    if (c != L'{') {
+      segments.back().text += c;
+      continue;
+    }
+
+    auto end = text.find(L'}', i);
+    if (end == text.npos) {
+      return false;
+    }
+    auto spec = text.substr(i + 1, end - i - 1);
+    auto colon = spec.find(L':');
+
+    wchar_t* parsed_end;
+    auto index = wcstol(spec.c_str(), &parsed_end, 10);
+    if (spec.empty() || colon == 0 ||
+        parsed_end != spec.c_str() + std::min(colon, spec.size()) ||
+        index < 0 || (size_t)index >= sources.size()) {
+      return false;
+    }
+
+    int32_t precision = -1;
+    if (colon != spec.npos) {
+      auto format = spec.substr(colon + 1);
+      if (format.size() < 2 || format[0] != L'.') {
+        return false;
+      }
+      precision = wcstol(format.c_str() + 1, &parsed_end, 10);
+      if (*parsed_end || precision < 0 || precision > 17) {
+        return false;
+      }
+    }
+
+    auto& placeholder = segments.emplace_back();
+    placeholder.source = index;
+    placeholder.precision = precision;
+    segments.emplace_back();
+    i = end;
+  }
+  last_values.clear();
+  return true;
+}
+
+static double read_value(const TooltipUpdater::source& source) {
+  // Plain aligned reads, the writers only need each value to be consistent.
+  switch (source.type) {
+    case TooltipUpdater::value_type::int32: {
+      int32_t value;
+      memcpy(&value, source.data, sizeof(value));
+      return value;
+    }
+    case TooltipUpdater::value_type::uint32: {
+      uint32_t value;
+      memcpy(&value, source.data, sizeof(value));
+      return value;
+    }
+    case TooltipUpdater::value_type::float32: {
+      float value;
+      memcpy(&value, source.data, sizeof(value));
+      return value;
+    }
+    case TooltipUpdater::value_type::float64: {
+      double value;
+      memcpy(&value, source.data, sizeof(value));
+      return value;
+    }
+  }
+  return 0;
+}
+
+static void append_value(std::wstring& result, double value,
+                         TooltipUpdater::value_type type, int32_t precision) {
+  wchar_t buffer[64];
+  int written;
+  if (precision >= 0) {
+    written = swprintf(buffer, std::size(buffer), L"%.*f", precision, value);
+  } else if (type == TooltipUpdater::value_type::int32 ||
+             type == TooltipUpdater::value_type::uint32) {
+    written = swprintf(buffer, std::size(buffer), L"%.0f", value);
+  } else {
+    written = swprintf(buffer, std::size(buffer), L"%g", value);
+  }
+  // Too long with a fixed precision, e.g. 1e300, and the buffer may not be
+  // terminated. %g always fits.
+  if (written < 0) {
+    written = swprintf(buffer, std::size(buffer), L"%g", value);
+  }
+  result.append(buffer, std::max(written, 0));
+}
+
+bool TooltipUpdater::poll(std::wstring* result) {
+  std::vector<double> values;
+  values.reserve(sources.size());
+  for (auto& source : sources) {
+    values.push_back(read_value(source));
+  }
+  if (values == last_values) {
+    return false;
+  }
+  last_values = std::move(values);
+
+  result->clear();
+  for (auto& segment : segments) {
+    if (segment.source < 0) {
+      *result += segment.text;
+    } else {
+      append_value(*result, last_values[segment.source],
+                   sources[segment.source].type, segment.precision);
+    }
+  }
+  result->resize(bounded_text_length(*result, max_tooltip_length));
+  return true;
+}
+
+tooltip_updater_error map_tooltip_source_file(const std::wstring& path,
+                                              uint64_t offset, size_t size,
+                                              TooltipUpdater::source* result) {
+  Unique<HANDLE, CloseHandle> file =
+      CreateFileW(path.c_str(), GENERIC_READ,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    file.release();
+    return {"CreateFileW", (HRESULT)GetLastError()};
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    return {"GetFileSizeEx", (HRESULT)GetLastError()};
+  }
+  if (offset + size > (uint64_t)file_size.QuadPart) {
+    return {"MapViewOfFile", ERROR_HANDLE_EOF};
+  }
+
+  // The view keeps the mapping alive once it's closed.
+  Unique<HANDLE, CloseHandle> mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    return {"CreateFileMappingW", (HRESULT)GetLastError()};
+  }
+  auto view = std::make_shared<MappedView>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!view->value) {
+    return {"MapViewOfFile", (HRESULT)GetLastError()};
+  }
+
+  result->data = static_cast<const uint8_t*>(view->value) + offset;
+  result->view = std::move(view);
+  return {};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "unique.hh"
+
+struct tooltip_updater_error {
+  const char* syscall = nullptr;
+  HRESULT code = 0;
+
+  explicit operator bool() const { return syscall != nullptr; }
+};
+
+using MappedView = Unique<LPCVOID, UnmapViewOfFile>;
+
+// Formats a tooltip from counters that other threads or processes publish in
+// shared memory, so it can be kept up to date from the message thread without
+// waking JS.
+struct TooltipUpdater {
+  enum class value_type { int32, uint32, float32, float64 };
+
+  struct source {
+    // Into a SharedArrayBuffer kept alive by the caller, or `view`.
+    const void* data = nullptr;
+    value_type type = value_type::int32;
+    std::shared_ptr<MappedView> view;
+  };
+
+  std::vector<source> sources;
+  DWORD interval_ms = 1000;
+
+  // `text` has "{index}" or "{index:.precision}" for each value from sources,
+  // and "{{" for a literal "{". Returns false if it is invalid.
+  bool parse_template(const std::wstring& text);
+
+  // Reads the sources, and if any have changed since the last call (or this is
+  // the first), sets `result` to the formatted tooltip and returns true.
+  bool poll(std::wstring* result);
+
+ private:
+  struct segment {
+    std::wstring text;
+    // Index into sources, or -1 for just text.
+    int32_t source = -1;
+    int32_t precision = -1;
+  };
+
+  std::vector<segment> segments;
+  std::vector<double> last_values;
+};
+
+// Maps `path` read-only, checking `size` bytes at `offset` are in the file.
+tooltip_updater_error map_tooltip_source_file(const std::wstring& path,
+                                              uint64_t offset, size_t size,
+                                              TooltipUpdater::source* result);
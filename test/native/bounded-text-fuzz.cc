@@ -0,0 +1,161 @@
+#include "bounded-text.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+// Checks the truncation invariants for arbitrary UTF-16, including unpaired
+// surrogates. Runs as a libFuzzer target when built with
+// NATIVE_TESTS_LIBFUZZER, otherwise main() below feeds it random text built
+// from pieces that are awkward to cut, e.g. pairs and combining sequences.
+
+static bool is_high_surrogate(wchar_t c) { return c >= 0xD800 && c < 0xDC00; }
+static bool is_low_surrogate(wchar_t c) { return c >= 0xDC00 && c < 0xE000; }
+
+static void fail(const char* what, const std::wstring& text, size_t bound) {
+  std::printf("FAIL %s: bound %zu, text", what, bound);
+  for (auto c : text) std::printf(" %04X", (unsigned)c);
+  std::printf("\n");
+  std::abort();
+}
+
+// Whether cutting before `text[index]` would separate it from the character
+// it extends, for the pieces main() uses.
+static bool extends(const std::wstring& text, size_t index) {
+  auto c = text[index];
+  if (index != 0 && text[index - 1] == 0x200D) return true;
+  if (is_low_surrogate(c)) {
+    return index != 0 && is_high_surrogate(text[index - 1]);
+  }
+  if (c == 0xD83C && index + 1 != text.size() && text[index + 1] >= 0xDFFB &&
+      text[index + 1] <= 0xDFFF) {
+    return true;
+  }
+  return c == 0x0301 || c == 0x20DD || c == 0xFE0F || c == 0x200D;
+}
+
+static void check_length(const std::wstring& text, size_t max_length) {
+  auto length = bounded_text_length(text, max_length);
+  if (text.size() <= max_length) {
+    if (length != text.size()) {
+      fail("shortened text that fits", text, max_length);
+    }
+    return;
+  }
+  if (length > max_length) fail("longer than max", text, max_length);
+  if (length != 0 && is_high_surrogate(text[length - 1]) &&
+      is_low_surrogate(text[length])) {
+    fail("split a surrogate pair", text, max_length);
+  }
+  // Only empty if there's no code point boundary to cut at.
+  if (length == 0 && max_length != 0 &&
+      !(max_length == 1 && is_high_surrogate(text[0]) &&
+        is_low_surrogate(text[1]))) {
+    fail("dropped everything", text, max_length);
+  }
+  // Cutting inside a cluster is only allowed when it's the whole prefix, at
+  // the last code point boundary that fits.
+  if (length != 0 && extends(text, length)) {
+    for (size_t i = 1; i != length; i++) {
+      if (!extends(text, i)) fail("cut inside a cluster", text, max_length);
+    }
+    if (length + 1 < max_length) fail("cut too short", text, max_length);
+  }
+}
+
+static void check_copy(const std::wstring& text, size_t capacity,
+                       bool ellipsis) {
+  constexpr wchar_t guard = 0xFFFF;
+  std::wstring dest(capacity + 4, guard);
+  auto length = copy_bounded_text(text, dest.data(), capacity, ellipsis);
+
+  for (size_t i = capacity; i != dest.size(); i++) {
+    if (dest[i] != guard) fail("wrote past capacity", text, capacity);
+  }
+  if (capacity == 0) {
+    if (length != 0) fail("copied without capacity", text, capacity);
+    return;
+  }
+  if (length >= capacity || dest[length] != 0) {
+    fail("unterminated", text, capacity);
+  }
+
+  std::wstring expected;
+  if (text.size() < capacity) {
+    expected = text;
+  } else if (ellipsis && capacity >= 2) {
+    expected = text.substr(0, bounded_text_length(text, capacity - 2));
+    expected += (wchar_t)0x2026;
+  } else {
+    expected = text.substr(0, bounded_text_length(text, capacity - 1));
+  }
+  if (dest.compare(0, length, expected) != 0 || length != expected.size()) {
+    fail("copied the wrong text", text, capacity);
+  }
+}
+
+static void check_text(const std::wstring& text) {
+  for (size_t bound = 0; bound <= text.size() + 1; bound++) {
+    check_length(text, bound);
+    check_copy(text, bound, true);
+    check_copy(text, bound, false);
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::wstring text;
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    text += (wchar_t)(data[i] | data[i + 1] << 8);
+  }
+  check_text(text);
+  return 0;
+}
+
+#ifndef NATIVE_TESTS_LIBFUZZER
+int main(int argc, char** argv) {
+  // Code units of each piece.
+  static const std::wstring pieces[] = {
+      L"a",
+      L"Z",
+      {0x00E9},          // Precomposed e acute
+      {0x0301},          // Combining acute accent
+      {0x20DD},          // Combining enclosing circle
+      {0xFE0F},          // Variation selector 16
+      {0x200D},          // Zero width joiner
+      {0x2764},          // Heart
+      {0x4E2D},          // CJK
+      {0xD83D, 0xDE00},  // Grinning face
+      {0xD83D, 0xDC4D},  // Thumbs up
+      {0xD83C, 0xDFFD},  // Skin tone modifier
+      {0xD83D, 0xDC68},  // Man
+      {0xD83D, 0xDCBB},  // Laptop
+      {0xD800},          // Unpaired high surrogate
+      {0xDC00},          // Unpaired low surrogate
+  };
+  constexpr size_t piece_count = sizeof(pieces) / sizeof(pieces[0]);
+
+  auto seed = argc > 1 ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : 1u;
+  auto iterations = argc > 2 ? std::atoi(argv[2]) : 20000;
+  std::mt19937 random{seed};
+
+  for (int i = 0; i != iterations; i++) {
+    std::wstring text;
+    auto count = random() % 24;
+    for (size_t j = 0; j != count; j++) text += pieces[random() % piece_count];
+    check_text(text);
+  }
+
+  // Arbitrary code units as well, as libFuzzer would give.
+  for (int i = 0; i != iterations; i++) {
+    uint8_t data[32];
+    auto size = random() % sizeof(data);
+    for (size_t j = 0; j != size; j++) data[j] = (uint8_t)random();
+    LLVMFuzzerTestOneInput(data, size);
+  }
+
+  std::printf("All passed\n");
+  return 0;
+}
+#endif
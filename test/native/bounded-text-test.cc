@@ -0,0 +1,100 @@
+#include "bounded-text.hh"
+
+#include <cstdio>
+#include <string>
+
+// Built as UTF-16 code units, as on Windows, even where wchar_t is 32 bits.
+static std::wstring utf16(std::initializer_list<uint32_t> code_points) {
+  std::wstring result;
+  for (auto c : code_points) {
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      result += (wchar_t)(0xD800 + (c >> 10));
+      result += (wchar_t)(0xDC00 + (c & 0x3FF));
+    } else {
+      result += (wchar_t)c;
+    }
+  }
+  return result;
+}
+
+static int failures = 0;
+
+static void expect_length(const char* name, const std::wstring& text,
+                          size_t max_length, size_t expected) {
+  auto actual = bounded_text_length(text, max_length);
+  if (actual != expected) {
+    std::printf("FAIL %s: max %zu, expected %zu, got %zu\n", name, max_length,
+                expected, actual);
+    failures++;
+  }
+}
+
+static void expect_copy(const char* name, const std::wstring& text,
+                        size_t capacity, bool ellipsis,
+                        const std::wstring& expected) {
+  wchar_t dest[16];
+  auto length = copy_bounded_text(text, dest, capacity, ellipsis);
+  if (std::wstring(dest, length) != expected || dest[length] != 0) {
+    std::printf("FAIL %s: capacity %zu\n", name, capacity);
+    failures++;
+  }
+}
+
+int main() {
+  auto ascii = utf16({'a', 'b', 'c', 'd'});
+  expect_length("fits", ascii, 4, 4);
+  expect_length("fits with room", ascii, 10, 4);
+  expect_length("truncated", ascii, 2, 2);
+  expect_length("empty", utf16({}), 0, 0);
+  expect_length("zero", ascii, 0, 0);
+
+  // U+1F600 is a surrogate pair.
+  auto pair = utf16({'a', 0x1F600, 'b'});
+  expect_length("before pair", pair, 1, 1);
+  expect_length("inside pair", pair, 2, 1);
+  expect_length("after pair", pair, 3, 3);
+
+  // e + U+0301 COMBINING ACUTE ACCENT.
+  auto combining = utf16({'a', 'e', 0x0301, 'b'});
+  expect_length("before mark", combining, 2, 1);
+  expect_length("after mark", combining, 3, 3);
+
+  // Heart + U+FE0F VARIATION SELECTOR-16.
+  auto variation = utf16({'a', 0x2764, 0xFE0F});
+  expect_length("before selector", variation, 2, 1);
+
+  // Thumbs up + U+1F3FD skin tone modifier, both surrogate pairs.
+  auto modifier = utf16({'a', 0x1F44D, 0x1F3FD, 'b'});
+  expect_length("before modifier", modifier, 3, 1);
+  expect_length("inside modifier", modifier, 4, 1);
+  expect_length("after modifier", modifier, 5, 5);
+
+  // Man + U+200D ZERO WIDTH JOINER + laptop.
+  auto joined = utf16({'a', 0x1F468, 0x200D, 0x1F4BB, 'b'});
+  expect_length("before joiner", joined, 3, 1);
+  expect_length("after joiner", joined, 4, 1);
+  expect_length("inside joined", joined, 5, 1);
+  expect_length("after joined", joined, 6, 6);
+
+  // Nothing before the cluster: cut at the code point boundary instead.
+  auto leading = utf16({'e', 0x0301, 0x0302});
+  expect_length("leading cluster", leading, 2, 2);
+  auto leading_pair = utf16({0x1F44D, 0x1F3FD});
+  expect_length("leading pair", leading_pair, 3, 2);
+  expect_length("leading half pair", leading_pair, 1, 0);
+
+  expect_copy("copy fits", ascii, 5, true, ascii);
+  expect_copy("copy ellipsis", ascii, 4, true, utf16({'a', 'b', 0x2026}));
+  expect_copy("copy no ellipsis", ascii, 4, false, utf16({'a', 'b', 'c'}));
+  expect_copy("copy only ellipsis", ascii, 2, true, utf16({0x2026}));
+  expect_copy("copy terminator only", ascii, 1, true, utf16({}));
+  expect_copy("copy pair ellipsis", pair, 4, true, utf16({'a', 0x2026}));
+
+  if (failures) {
+    std::printf("%d failed\n", failures);
+    return 1;
+  }
+  std::printf("All passed\n");
+  return 0;
+}
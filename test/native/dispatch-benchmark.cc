@@ -0,0 +1,100 @@
+#include "test-pump.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+// Hops per second between threads through test_pump, which batches calls as
+// the message thread does:
+//   one-way: one thread posts, the other runs, as for icon updates.
+//   round trip: each call posts the next back, as for a blocking call.
+// Each is also run with the std::function allocated per call the message loop
+// used to post, for comparison.
+
+using clock_type = std::chrono::steady_clock;
+
+struct payload {
+  char bytes[64] = {};
+};
+
+static double seconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+template <typename MakeCall>
+static double one_way(int hops, MakeCall make_call) {
+  test_pump pump;
+  std::atomic<int> calls{0};
+  std::thread consumer{[&] {
+    while (pump.run_calls()) {
+    }
+  }};
+
+  auto start = clock_type::now();
+  for (int i = 0; i != hops; i++) pump.post(make_call(calls));
+  while (calls != hops) std::this_thread::yield();
+  auto elapsed = seconds_since(start);
+
+  pump.stop();
+  consumer.join();
+  return hops / elapsed;
+}
+
+template <typename MakeCall>
+static double round_trip(int hops, MakeCall make_call) {
+  test_pump pumps[2];
+  std::atomic<int> calls{0};
+  std::thread threads[2];
+  for (auto& pump : pumps) {
+    threads[&pump - pumps] = std::thread{[&pump] {
+      while (pump.run_calls()) {
+      }
+    }};
+  }
+
+  // Each call runs on alternate threads, posting the next.
+  std::function<void()> bounce = [&] {
+    if (++calls < hops) {
+      pumps[calls % 2].post(make_call([&] { bounce(); }));
+    }
+  };
+  auto start = clock_type::now();
+  pumps[0].post(make_call([&] { bounce(); }));
+  while (calls < hops) std::this_thread::yield();
+  auto elapsed = seconds_since(start);
+
+  for (auto& pump : pumps) pump.stop();
+  for (auto& thread : threads) thread.join();
+  return hops / elapsed;
+}
+
+int main(int argc, char** argv) {
+  int hops = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+  auto inline_call = [](std::atomic<int>& calls) -> test_pump::Call {
+    return [&calls, data = payload{}] { calls += 1 + data.bytes[0]; };
+  };
+  auto allocated_call = [](std::atomic<int>& calls) -> test_pump::Call {
+    auto body = std::make_unique<std::function<void()>>(
+        [&calls, data = payload{}] { calls += 1 + data.bytes[0]; });
+    return [body = std::move(body)] { (*body)(); };
+  };
+  auto inline_next = [](auto next) -> test_pump::Call { return next; };
+  auto allocated_next = [](auto next) -> test_pump::Call {
+    auto body = std::make_unique<std::function<void()>>(next);
+    return [body = std::move(body)] { (*body)(); };
+  };
+
+  std::printf("%-24s %14s\n", "", "hops/s");
+  std::printf("%-24s %14.0f\n", "one-way inline", one_way(hops, inline_call));
+  std::printf("%-24s %14.0f\n", "one-way allocated",
+              one_way(hops, allocated_call));
+  std::printf("%-24s %14.0f\n", "round trip inline",
+              round_trip(hops / 10, inline_next));
+  std::printf("%-24s %14.0f\n", "round trip allocated",
+              round_trip(hops / 10, allocated_next));
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "test-pump.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// Every allocation in the process, from any thread.
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations++;
+  if (auto result = std::malloc(size ? size : 1)) {
+    return result;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+static int failures = 0;
+
+static void expect_no_allocations(const char* name, size_t before) {
+  auto count = allocations - before;
+  if (count) {
+    std::printf("FAIL %s: %zu allocations\n", name, count);
+    failures++;
+  }
+}
+
+// About as much as the message loop's calls capture, e.g. Menu.show().
+struct payload {
+  char bytes[64] = {};
+};
+
+static void test_inline_function() {
+  int calls = 0;
+  payload data;
+  auto before = allocations.load();
+  {
+    InlineFunction<void()> f = [&calls, data] { calls += data.bytes[0] + 1; };
+    auto moved = std::move(f);
+    moved();
+    InlineFunction<void()> assigned;
+    assigned = std::move(moved);
+    assigned();
+    assigned.reset();
+  }
+  expect_no_allocations("InlineFunction", before);
+  if (calls != 2) {
+    std::printf("FAIL InlineFunction: %d calls\n", calls);
+    failures++;
+  }
+}
+
+static void test_call_queue() {
+  CallQueue<InlineFunction<void()>> queue;
+  int calls = 0;
+  auto push = [&](size_t count) {
+    for (size_t i = 0; i != count; i++) {
+      queue.push([&calls, data = payload{}] { calls += 1 + data.bytes[0]; });
+    }
+  };
+  auto drain = [&] {
+    InlineFunction<void()> call;
+    while (queue.pop(&call)) call();
+  };
+
+  // Grows to the most queued at once, then reuses its slots.
+  push(100);
+  drain();
+  auto before = allocations.load();
+  for (int round = 0; round != 1000; round++) {
+    push(100);
+    drain();
+  }
+  expect_no_allocations("CallQueue", before);
+  if (calls != 100 * 1001) {
+    std::printf("FAIL CallQueue: %d calls\n", calls);
+    failures++;
+  }
+}
+
+static void test_cross_thread() {
+  constexpr int warmup = 10000;
+  constexpr int measured = 100000;
+  test_pump pump;
+  std::atomic<int> calls{0};
+
+  std::thread consumer{[&] {
+    while (pump.run_calls()) {
+    }
+  }};
+
+  auto post = [&] {
+    pump.post([&calls, data = payload{}] { calls += 1 + data.bytes[0]; });
+  };
+  for (int i = 0; i != warmup; i++) post();
+  // Until the queue has grown to what the measured posts can reach.
+  while (calls != warmup) std::this_thread::yield();
+  for (int i = 0; i != warmup; i++) post();
+  while (calls != 2 * warmup) std::this_thread::yield();
+
+  auto before = allocations.load();
+  for (int i = 0; i != measured; i++) {
+    post();
+    // Keep the queue within what it's grown to.
+    if (i % warmup == warmup - 1) {
+      while (calls != 2 * warmup + i + 1) std::this_thread::yield();
+    }
+  }
+  while (calls != 2 * warmup + measured) std::this_thread::yield();
+  expect_no_allocations("cross-thread", before);
+
+  pump.stop();
+  consumer.join();
+}
+
+int main() {
+  test_inline_function();
+  test_call_queue();
+  test_cross_thread();
+
+  if (failures) {
+    std::printf("%d failed\n", failures);
+    return 1;
+  }
+  std::printf("All passed\n");
+  return 0;
+}
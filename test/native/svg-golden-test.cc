@@ -0,0 +1,149 @@
+#include "svg-raster.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Renders icons covering each feature of the rasterizer, and compares them to
+// the PAM images in the `golden` directory given as the first argument. Run
+// with --update as the second argument to rewrite them after an intended
+// change, then check the new images by eye.
+
+struct golden_case {
+  const char* name;
+  int32_t size;
+  const char* source;
+};
+
+static const golden_case cases[] = {
+    {"rect", 16,
+     "<svg viewBox='0 0 16 16'><rect x='2' y='3' width='10' height='8' "
+     "fill='#3080ff'/></svg>"},
+    {"circle-stroke", 32,
+     "<svg viewBox='0 0 32 32'><circle cx='16' cy='16' r='11' fill='none' "
+     "stroke='red' stroke-width='3'/></svg>"},
+    {"path-evenodd", 32,
+     "<svg viewBox='0 0 32 32'><path fill-rule='evenodd' d='M4 4 H28 V28 H4 Z "
+     "M10 10 H22 V22 H10 Z'/></svg>"},
+    {"curves-round-caps", 32,
+     "<svg viewBox='0 0 32 32'><path d='M4 24 C8 4 24 4 28 24' fill='none' "
+     "stroke='#208020' stroke-width='4' stroke-linecap='round'/></svg>"},
+    {"linear-gradient", 32,
+     "<svg viewBox='0 0 32 32'><defs><linearGradient id='g' x1='0' x2='1'>"
+     "<stop offset='0' stop-color='yellow'/>"
+     "<stop offset='1' stop-color='purple' stop-opacity='0.5'/>"
+     "</linearGradient></defs>"
+     "<rect width='32' height='32' rx='6' fill='url(#g)'/></svg>"},
+    {"radial-gradient", 32,
+     "<svg viewBox='0 0 32 32'><defs><radialGradient id='g'>"
+     "<stop offset='0' stop-color='white'/>"
+     "<stop offset='1' stop-color='#004080'/>"
+     "</radialGradient></defs>"
+     "<circle cx='16' cy='16' r='14' fill='url(#g)'/></svg>"},
+    {"transform-opacity", 32,
+     "<svg viewBox='0 0 32 32'><g transform='rotate(30 16 16)' opacity='0.75'>"
+     "<rect x='8' y='8' width='16' height='16' fill='orange' stroke='black' "
+     "stroke-linejoin='bevel'/></g></svg>"},
+    {"arc-viewbox-fit", 24,
+     "<svg viewBox='0 0 20 10'><path d='M2 8 A6 6 0 0 1 18 8 Z' "
+     "style='fill: teal'/></svg>"},
+};
+
+// Each channel may differ by this much, for differences in float rounding
+// between compilers.
+constexpr int tolerance = 2;
+
+static std::vector<uint8_t> to_rgba(const IconBitmap& bitmap) {
+  std::vector<uint8_t> result;
+  for (auto pixel : bitmap.pixels) {
+    result.push_back((uint8_t)(pixel >> 16));
+    result.push_back((uint8_t)(pixel >> 8));
+    result.push_back((uint8_t)pixel);
+    result.push_back((uint8_t)(pixel >> 24));
+  }
+  return result;
+}
+
+static bool write_pam(const std::string& path, int32_t size,
+                      const std::vector<uint8_t>& rgba) {
+  auto file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+  std::fprintf(file,
+               "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\n"
+               "TUPLTYPE RGB_ALPHA\nENDHDR\n",
+               size, size);
+  auto ok = std::fwrite(rgba.data(), 1, rgba.size(), file) == rgba.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+static bool read_pam(const std::string& path, int32_t size,
+                     std::vector<uint8_t>* rgba) {
+  auto file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+  int width = 0, height = 0;
+  char line[64];
+  while (std::fgets(line, sizeof(line), file)) {
+    std::sscanf(line, "WIDTH %d", &width);
+    std::sscanf(line, "HEIGHT %d", &height);
+    if (std::strcmp(line, "ENDHDR\n") == 0) break;
+  }
+  rgba->resize((size_t)size * size * 4);
+  auto ok = width == size && height == size &&
+            std::fread(rgba->data(), 1, rgba->size(), file) == rgba->size();
+  std::fclose(file);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::printf("usage: %s <golden dir> [--update]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  bool update = argc > 2 && std::strcmp(argv[2], "--update") == 0;
+
+  int failures = 0;
+  for (auto& c : cases) {
+    auto path = dir + "/" + c.name + ".pam";
+    IconBitmap bitmap;
+    std::string error;
+    if (!rasterize_svg(c.source, c.size, c.size, &bitmap, &error)) {
+      std::printf("FAIL %s: %s\n", c.name, error.c_str());
+      failures++;
+      continue;
+    }
+    auto actual = to_rgba(bitmap);
+
+    if (update) {
+      if (!write_pam(path, c.size, actual)) {
+        std::printf("FAIL %s: can't write %s\n", c.name, path.c_str());
+        failures++;
+      }
+      continue;
+    }
+
+    std::vector<uint8_t> expected;
+    if (!read_pam(path, c.size, &expected)) {
+      std::printf("FAIL %s: can't read %s\n", c.name, path.c_str());
+      failures++;
+      continue;
+    }
+    size_t differing = 0;
+    for (size_t i = 0; i != actual.size(); i++) {
+      if (std::abs(actual[i] - expected[i]) > tolerance) differing++;
+    }
+    if (differing) {
+      std::printf("FAIL %s: %zu channels differ\n", c.name, differing);
+      failures++;
+    }
+  }
+
+  if (failures) {
+    std::printf("%d failed\n", failures);
+    return 1;
+  }
+  std::printf(update ? "Updated\n" : "All passed\n");
+  return 0;
+}
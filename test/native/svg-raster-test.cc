@@ -0,0 +1,86 @@
+#include "svg-raster.hh"
+
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+
+// Renders `source`, which must not crash or leave pixels unwritten, whether or
+// not it's accepted.
+static void expect_rendered(const char* name, const std::string& source,
+                            bool expected, int32_t size = 16) {
+  IconBitmap bitmap;
+  std::string error;
+  auto ok = rasterize_svg(source, size, size, &bitmap, &error);
+  if (ok != expected) {
+    std::printf("FAIL %s: expected %s, got %s %s\n", name,
+                expected ? "success" : "failure", ok ? "success" : "failure",
+                error.c_str());
+    failures++;
+  } else if (ok && bitmap.pixels.size() != (size_t)size * size) {
+    std::printf("FAIL %s: %zu pixels\n", name, bitmap.pixels.size());
+    failures++;
+  }
+}
+
+static std::string svg(const std::string& body) {
+  return "<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 16 16'>" + body +
+         "</svg>";
+}
+
+int main() {
+  expect_rendered("plain", svg("<rect width='8' height='8'/>"), true);
+
+  // Out of float range, which would parse as inf: the path data is invalid from
+  // there, so nothing is drawn.
+  expect_rendered("huge path", svg("<path d='M1e39 0 L-1e39 10 L0 10 Z'/>"),
+                  true);
+  // In range, but overflowing once transformed.
+  expect_rendered(
+      "huge transform",
+      svg("<path transform='scale(1e30)' d='M1e30 0 L-1e30 10 L0 16 Z'/>"),
+      true);
+  expect_rendered("transform overflow",
+                  svg("<g transform='scale(1e30) scale(1e30)'>"
+                      "<rect width='8' height='8'/></g>"),
+                  true);
+  expect_rendered("huge stroke",
+                  svg("<path stroke='red' stroke-width='1e39' "
+                      "d='M0 0 L16 16'/>"),
+                  true);
+  expect_rendered("largest stroke",
+                  svg("<path stroke='red' stroke-width='3e38' "
+                      "stroke-linecap='round' stroke-linejoin='round' "
+                      "d='M0 0 L16 16 L0 16'/>"),
+                  true);
+  expect_rendered("spanning edges",
+                  svg("<path d='M3e38 0 L-3e38 16 L-3e38 0 Z'/>"), true);
+  expect_rendered("huge curve",
+                  svg("<path d='M0 0 C3e38 3e38 -3e38 -3e38 16 16 Z'/>"),
+                  true);
+  expect_rendered("huge arc", svg("<path d='M0 0 A3e38 1e-30 0 1 1 16 16'/>"),
+                  true);
+  expect_rendered("huge circle", svg("<circle cx='8' cy='8' r='3e38'/>"),
+                  true);
+  expect_rendered("huge gradient",
+                  svg("<defs><linearGradient id='g' x2='3e38'>"
+                      "<stop offset='0' stop-color='red'/>"
+                      "<stop offset='1' stop-color='blue'/>"
+                      "</linearGradient></defs>"
+                      "<rect width='16' height='16' fill='url(#g)' "
+                      "transform='scale(3e38)'/>"),
+                  true);
+
+  std::string deep;
+  for (int i = 0; i != max_svg_depth + 1; i++) deep += "<g>";
+  for (int i = 0; i != max_svg_depth + 1; i++) deep += "</g>";
+  expect_rendered("too deep", svg(deep), false);
+  expect_rendered("too large", svg(""), false, max_svg_size + 1);
+
+  if (failures) {
+    std::printf("%d failed\n", failures);
+    return 1;
+  }
+  std::printf("All passed\n");
+  return 0;
+}
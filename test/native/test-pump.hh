@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include "call-queue.hh"
+#include "inline-function.hh"
+
+// The batching of message_pump in notify-icon-message-loop.cc, with a condition
+// variable in place of the posted WM_USER_CALL, so cross-thread dispatch can be
+// measured without Windows.
+struct test_pump {
+  using Call = InlineFunction<void()>;
+
+  // Can be called from any thread.
+  void post(Call body) {
+    std::lock_guard lock{mutex};
+    queue.push(std::move(body));
+    if (!posted) {
+      posted = true;
+      wake.notify_one();
+    }
+  }
+
+  // On the consumer thread, waits for a wake then runs the calls queued
+  // before it, as message_pump::run_calls() does. Returns false once stopped
+  // and drained.
+  bool run_calls() {
+    size_t count;
+    {
+      std::unique_lock lock{mutex};
+      wake.wait(lock, [&] { return posted || stopped; });
+      if (!posted) {
+        return false;
+      }
+      count = queue.size();
+      posted = false;
+    }
+
+    Call call;
+    while (count--) {
+      {
+        std::lock_guard lock{mutex};
+        if (!queue.pop(&call)) {
+          break;
+        }
+      }
+      call();
+    }
+    return true;
+  }
+
+  void stop() {
+    std::lock_guard lock{mutex};
+    stopped = true;
+    wake.notify_one();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable wake;
+  CallQueue<Call> queue;
+  bool posted = false;
+  bool stopped = false;
+};